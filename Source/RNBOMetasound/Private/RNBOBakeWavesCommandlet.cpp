@@ -0,0 +1,66 @@
+#include "RNBOBakeWavesCommandlet.h"
+#include "RNBOBakedWave.h"
+
+#include "MetasoundLog.h"
+#include "DSP/FloatArrayMath.h"
+#include "Sound/SoundWave.h"
+
+URNBOBakeWavesCommandlet::URNBOBakeWavesCommandlet()
+{
+    IsClient = false;
+    IsServer = false;
+    IsEditor = true;
+    LogToConsole = true;
+}
+
+int32 URNBOBakeWavesCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+    TArray<FSoftObjectPath> Paths = Waves;
+    FString WavesParam;
+    if (FParse::Value(*Params, TEXT("Waves="), WavesParam, false)) {
+        TArray<FString> Names;
+        WavesParam.ParseIntoArray(Names, TEXT(","));
+        for (const FString& Name : Names) {
+            Paths.Add(FSoftObjectPath(Name));
+        }
+    }
+
+    int32 Failed = 0;
+    for (const FSoftObjectPath& Path : Paths) {
+        USoundWave* Wave = Cast<USoundWave>(Path.TryLoad());
+        if (Wave == nullptr) {
+            UE_LOG(LogMetaSound, Error, TEXT("RNBO %s is not a sound wave"), *Path.ToString());
+            Failed++;
+            continue;
+        }
+
+        // the imported data rather than the compressed data, there is no point in baking codec artifacts
+        TArray<uint8> PCM;
+        uint32 SampleRate = 0;
+        uint16 NumChannels = 0;
+        if (!Wave->GetImportedSoundWaveData(PCM, SampleRate, NumChannels) || NumChannels == 0 || SampleRate == 0) {
+            UE_LOG(LogMetaSound, Error, TEXT("RNBO failed to get the imported data of %s"), *Path.ToString());
+            Failed++;
+            continue;
+        }
+
+        RNBOMetasound::FDecodedWave Decoded;
+        Decoded.NumChannels = NumChannels;
+        Decoded.SampleRate = SampleRate;
+        const int32 NumSamples = PCM.Num() / static_cast<int32>(sizeof(int16));
+        Decoded.Samples.SetNumUninitialized(NumSamples);
+        Audio::ArrayPcm16ToFloat(TArrayView<const int16>(reinterpret_cast<const int16*>(PCM.GetData()), NumSamples), Decoded.Samples);
+
+        if (!RNBOMetasound::WriteBakedWave(Wave->GetPackage()->GetFName(), Decoded)) {
+            Failed++;
+            continue;
+        }
+        UE_LOG(LogMetaSound, Display, TEXT("RNBO baked %s to %s"), *Path.ToString(), *RNBOMetasound::GetBakedWavePath(Wave->GetPackage()->GetFName()));
+    }
+    return Failed > 0 ? 1 : 0;
+#else
+    UE_LOG(LogMetaSound, Error, TEXT("RNBOBakeWaves needs the editor"));
+    return 1;
+#endif
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "RNBOBakeWavesCommandlet.generated.h"
+
+/**
+ * Decodes wave assets used on RNBO WaveAsset pins ahead of time, run it before cooking:
+ * UnrealEditor-Cmd Project.uproject -run=RNBOBakeWaves -Waves=/Game/Audio/Foo.Foo,/Game/Audio/Bar.Bar
+ * The waves listed in the [/Script/RNBOMetasound.RNBOBakeWavesCommandlet] section of DefaultGame.ini are always baked.
+ * The float data is written to Content/RNBOPCM, which should be staged as NonUFS, and memory mapped instead of decoded at runtime.
+ */
+UCLASS(config = Game)
+class URNBOBakeWavesCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+
+  public:
+    URNBOBakeWavesCommandlet();
+
+    virtual int32 Main(const FString& Params) override;
+
+  private:
+    UPROPERTY(config)
+    TArray<FSoftObjectPath> Waves;
+};
@@ -0,0 +1,99 @@
+#include "RNBOBakedWave.h"
+
+#include "MetasoundLog.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+#include <atomic>
+
+namespace RNBOMetasound {
+
+namespace {
+// a platform that can't map files fails for every baked wave on every load, only warn the first time
+void LogMapFailed(const FString& Path)
+{
+    static std::atomic<bool> bWarned = false;
+    if (!bWarned.exchange(true)) {
+        UE_LOG(LogMetaSound, Warning, TEXT("RNBO failed to map baked wave %s, decoding instead, further failures are logged as verbose"), *Path);
+    }
+    else {
+        UE_LOG(LogMetaSound, Verbose, TEXT("RNBO failed to map baked wave %s"), *Path);
+    }
+}
+} // namespace
+
+FString GetBakedWavePath(FName PackageName)
+{
+    FString Name = PackageName.ToString();
+    Name.RemoveFromStart(TEXT("/"));
+    return FPaths::ProjectContentDir() / TEXT("RNBOPCM") / Name + TEXT(".rnbopcm");
+}
+
+FDecodedWavePtr MapBakedWave(const FSoundWaveProxyPtr& WaveProxy)
+{
+    const FString Path = GetBakedWavePath(WaveProxy->GetPackageName());
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    if (!PlatformFile.FileExists(*Path)) {
+        return nullptr;
+    }
+
+    TUniquePtr<IMappedFileHandle> MappedFile(PlatformFile.OpenMapped(*Path));
+    if (!MappedFile.IsValid() || MappedFile->GetFileSize() < static_cast<int64>(sizeof(FBakedWaveHeader))) {
+        LogMapFailed(Path);
+        return nullptr;
+    }
+    TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+    if (!MappedRegion.IsValid()) {
+        LogMapFailed(Path);
+        return nullptr;
+    }
+
+    FBakedWaveHeader Header;
+    FMemory::Memcpy(&Header, MappedRegion->GetMappedPtr(), sizeof(Header));
+    const int64 DataSize = MappedRegion->GetMappedSize() - static_cast<int64>(sizeof(Header));
+    if (Header.Magic != FBakedWaveHeader::ExpectedMagic || Header.Version != FBakedWaveHeader::CurrentVersion || Header.NumChannels == 0 || Header.SampleRate <= 0.0
+        || Header.NumSamples > static_cast<uint64>(MAX_int32) || static_cast<int64>(Header.NumSamples * sizeof(float)) > DataSize) {
+        UE_LOG(LogMetaSound, Warning, TEXT("RNBO baked wave %s is invalid or from another version, bake it again"), *Path);
+        return nullptr;
+    }
+
+    // the wave was changed since it was baked
+    const double Duration = static_cast<double>(Header.NumSamples / Header.NumChannels) / Header.SampleRate;
+    if (static_cast<int32>(Header.NumChannels) != WaveProxy->GetNumChannels() || FMath::Abs(Duration - WaveProxy->GetDuration()) > 0.01) {
+        UE_LOG(LogMetaSound, Warning, TEXT("RNBO baked wave %s doesn't match its wave anymore, bake it again"), *Path);
+        return nullptr;
+    }
+
+    FDecodedWavePtr Wave = MakeDecodedWave();
+    Wave->NumChannels = static_cast<int32>(Header.NumChannels);
+    Wave->SampleRate = Header.SampleRate;
+    Wave->MappedSamples = reinterpret_cast<const float*>(MappedRegion->GetMappedPtr() + sizeof(Header));
+    Wave->NumMappedSamples = static_cast<int32>(Header.NumSamples);
+    Wave->MappedFile = MoveTemp(MappedFile);
+    Wave->MappedRegion = MoveTemp(MappedRegion);
+    return Wave;
+}
+
+bool WriteBakedWave(FName PackageName, const FDecodedWave& Wave)
+{
+    const FString Path = GetBakedWavePath(PackageName);
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Path));
+
+    TUniquePtr<IFileHandle> File(PlatformFile.OpenWrite(*Path));
+    if (!File.IsValid()) {
+        UE_LOG(LogMetaSound, Error, TEXT("RNBO failed to open %s for writing"), *Path);
+        return false;
+    }
+
+    FBakedWaveHeader Header;
+    Header.NumChannels = static_cast<uint32>(Wave.NumChannels);
+    Header.SampleRate = Wave.SampleRate;
+    Header.NumSamples = static_cast<uint64>(Wave.Num());
+    if (!File->Write(reinterpret_cast<const uint8*>(&Header), sizeof(Header)) || !File->Write(reinterpret_cast<const uint8*>(Wave.GetData()), static_cast<int64>(Wave.SizeInBytes()))) {
+        UE_LOG(LogMetaSound, Error, TEXT("RNBO failed to write %s"), *Path);
+        return false;
+    }
+    return true;
+}
+
+} // namespace RNBOMetasound
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RNBOWaveCache.h"
+
+namespace RNBOMetasound {
+
+// a wave decoded ahead of time by the RNBOBakeWaves commandlet, a header followed by the interleaved float samples
+// the files live in Content/RNBOPCM, named after the wave's package, and are staged as NonUFS so they can be memory mapped
+struct FBakedWaveHeader
+{
+    static constexpr uint32 ExpectedMagic = 0x50424E52; // RNBP
+    static constexpr uint32 CurrentVersion = 1;
+
+    uint32 Magic = ExpectedMagic;
+    uint32 Version = CurrentVersion;
+    uint32 NumChannels = 0;
+    uint32 Reserved = 0;
+    double SampleRate = 0.0;
+    uint64 NumSamples = 0;
+};
+
+// where the baked data of the wave in PackageName lives
+FString GetBakedWavePath(FName PackageName);
+
+// map the baked data of the wave, returns nullptr if there is none or it doesn't match the wave anymore
+// the mapping is read only, the loader hands copies of it to datarefs that aren't readonly
+FDecodedWavePtr MapBakedWave(const FSoundWaveProxyPtr& WaveProxy);
+
+// write Wave where GetBakedWavePath says, returns false on failure
+bool WriteBakedWave(FName PackageName, const FDecodedWave& Wave);
+
+} // namespace RNBOMetasound
@@ -0,0 +1,171 @@
+#include "RNBOCoreObjectPool.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Containers/Ticker.h"
+#include "Tasks/Task.h"
+#include <atomic>
+
+namespace {
+int32 CoreObjectPoolSizeCVar = 2;
+FAutoConsoleVariableRef CVarRNBOCoreObjectPoolSize(
+    TEXT("au.RNBO.CoreObjectPoolSize"),
+    CoreObjectPoolSizeCVar,
+    TEXT("Number of prepared RNBO core objects kept ready per export, sample rate and block size.\n")
+        TEXT("0: no pooling, every node makes its own"),
+    ECVF_Default);
+
+// every pool, so they can be emptied on shutdown
+FCriticalSection PoolsMutex;
+TArray<RNBOMetasound::FCoreObjectPool*> Pools;
+// refill and destroy tasks still running, they use module code
+std::atomic<int32> PendingTasks = 0;
+std::atomic<bool> bShutdown = false;
+
+std::atomic<RNBOMetasound::FRetiredCoreObject*> RetiredObjects = nullptr;
+std::atomic<bool> DestroyScheduled = false;
+FTSTicker::FDelegateHandle DestroyTickerHandle;
+
+void DestroyRetired()
+{
+    RNBOMetasound::FRetiredCoreObject* Retired = RetiredObjects.exchange(nullptr, std::memory_order_acquire);
+    while (Retired != nullptr) {
+        RNBOMetasound::FRetiredCoreObject* Next = Retired->Next;
+        // the core object's release callbacks drop the data its datarefs were bound to
+        delete Retired;
+        Retired = Next;
+    }
+}
+
+template <typename WorkType>
+void LaunchPoolTask(WorkType&& Work)
+{
+    PendingTasks++;
+    UE::Tasks::Launch(
+        UE_SOURCE_LOCATION,
+        [Work = MoveTemp(Work)]() mutable {
+            Work();
+            PendingTasks--;
+        },
+        UE::Tasks::ETaskPriority::BackgroundLow);
+}
+} // namespace
+
+namespace RNBOMetasound {
+
+void ResetCoreObject(RNBO::CoreObject& CoreObject, double SampleRate, int32 BlockSize, TFunctionRef<void(RNBO::ParameterIndex, const RNBO::ParameterInfo&)> SetInitialValue)
+{
+    CoreObject.prepareToProcess(SampleRate, BlockSize, true);
+    const RNBO::ParameterIndex NumParams = CoreObject.getNumParameters();
+    for (RNBO::ParameterIndex Index = 0; Index < NumParams; Index++) {
+        RNBO::ParameterInfo Info;
+        CoreObject.getParameterInfo(Index, &Info);
+        SetInitialValue(Index, Info);
+    }
+}
+
+void RetireCoreObject(TUniquePtr<FRetiredCoreObject> Retired)
+{
+    if (!Retired.IsValid()) {
+        return;
+    }
+    FRetiredCoreObject* Node = Retired.Release();
+    FRetiredCoreObject* Head = RetiredObjects.load(std::memory_order_relaxed);
+    do {
+        Node->Next = Head;
+    } while (!RetiredObjects.compare_exchange_weak(Head, Node, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void StartCoreObjectPools()
+{
+    DestroyTickerHandle = FTSTicker::GetCoreTicker().AddTicker(TEXT("RNBOCoreObjectPools"), 0.5f, [](float) {
+        if (RetiredObjects.load(std::memory_order_relaxed) != nullptr && !bShutdown.load() && !DestroyScheduled.exchange(true)) {
+            LaunchPoolTask([]() {
+                DestroyScheduled = false;
+                DestroyRetired();
+            });
+        }
+        return true;
+    });
+}
+
+void ShutdownCoreObjectPools()
+{
+    FTSTicker::GetCoreTicker().RemoveTicker(DestroyTickerHandle);
+    bShutdown = true;
+    while (PendingTasks.load() > 0) {
+        FPlatformProcess::Sleep(0.001f);
+    }
+    DestroyRetired();
+    TArray<FCoreObjectPtr> Objects;
+    {
+        FScopeLock Guard(&PoolsMutex);
+        for (FCoreObjectPool* Pool : Pools) {
+            FScopeLock PoolGuard(&Pool->Mutex);
+            for (auto& It : Pool->Ready) {
+                Objects.Append(MoveTemp(It.Value));
+            }
+            Pool->Ready.Empty();
+        }
+    }
+    // destroyed outside the locks
+}
+
+FCoreObjectPool::FCoreObjectPool(FFactoryFunction factoryFunction)
+    : FactoryFunction(factoryFunction)
+{
+    FScopeLock Guard(&PoolsMutex);
+    Pools.Add(this);
+}
+
+FCoreObjectPool::~FCoreObjectPool()
+{
+    FScopeLock Guard(&PoolsMutex);
+    Pools.Remove(this);
+}
+
+FCoreObjectPtr FCoreObjectPool::Create(const FKey& Key) const
+{
+    FCoreObjectPtr CoreObject = MakeUnique<RNBO::CoreObject>(RNBO::UniquePtr<RNBO::PatcherInterface>(FactoryFunction()()));
+    CoreObject->prepareToProcess(Key.SampleRate, Key.BlockSize);
+    return CoreObject;
+}
+
+FCoreObjectPtr FCoreObjectPool::Acquire(double SampleRate, int32 BlockSize)
+{
+    const FKey Key{ SampleRate, BlockSize };
+    FCoreObjectPtr CoreObject;
+    {
+        FScopeLock Guard(&Mutex);
+        TArray<FCoreObjectPtr>& Objects = Ready.FindOrAdd(Key);
+        if (Objects.Num() > 0) {
+            CoreObject = Objects.Pop(EAllowShrinking::No);
+        }
+        if (Objects.Num() < CoreObjectPoolSizeCVar && !Refilling.Contains(Key) && !bShutdown.load()) {
+            Refilling.Add(Key);
+            LaunchPoolTask([this, Key]() { Refill(Key); });
+        }
+    }
+    if (!CoreObject.IsValid()) {
+        CoreObject = Create(Key);
+    }
+    return CoreObject;
+}
+
+void FCoreObjectPool::Refill(const FKey& Key)
+{
+    while (true) {
+        {
+            FScopeLock Guard(&Mutex);
+            if (Ready.FindOrAdd(Key).Num() >= CoreObjectPoolSizeCVar || bShutdown.load()) {
+                Refilling.Remove(Key);
+                return;
+            }
+        }
+        // made outside the lock, this is the slow part
+        FCoreObjectPtr CoreObject = Create(Key);
+        FScopeLock Guard(&Mutex);
+        Ready.FindOrAdd(Key).Add(MoveTemp(CoreObject));
+    }
+}
+
+} // namespace RNBOMetasound
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// visual studio warnings we're having trouble with
+#pragma warning(disable : 4800 4065 4668 4804 4018 4060 4554 4018)
+#include "RNBO.h"
+
+namespace RNBOMetasound {
+
+using FCoreObjectPtr = TUniquePtr<RNBO::CoreObject>;
+
+// clears the DSP state with a forced prepare, then hands every parameter's info to SetInitialValue to put it back where it started
+void ResetCoreObject(RNBO::CoreObject& CoreObject, double SampleRate, int32 BlockSize, TFunctionRef<void(RNBO::ParameterIndex, const RNBO::ParameterInfo&)> SetInitialValue);
+
+// a core object its owner is done with, the owner makes this up front so retiring doesn't allocate
+struct FRetiredCoreObject
+{
+    FCoreObjectPtr CoreObject;
+    FRetiredCoreObject* Next = nullptr;
+};
+
+// used core objects are never reused, they may hold message state, patch owned data and whatever the patch set up on load
+// retiring only links the core object into a list, it is destroyed by a background task launched from a core ticker
+void RetireCoreObject(TUniquePtr<FRetiredCoreObject> Retired);
+
+// starts the ticker that destroys retired core objects
+void StartCoreObjectPools();
+// waits for the pools' background tasks, destroys what was retired and empties the pools
+// core objects retired after this are leaked rather than destroyed on the caller's thread
+void ShutdownCoreObjectPools();
+
+// prepared core objects of one export, keyed on sample rate and block size
+// au.RNBO.CoreObjectPoolSize sets how many are kept ready per key, a background task tops the pool up with new ones whenever one is taken
+// pools live for the life of the module, ShutdownCoreObjectPools has to run before it unloads
+class FCoreObjectPool
+{
+  public:
+    using FFactoryFunction = RNBO::PatcherFactoryFunctionPtr (*)();
+
+    explicit FCoreObjectPool(FFactoryFunction factoryFunction);
+    ~FCoreObjectPool();
+
+    // a prepared core object in its initial state, only made here if the pool has none ready
+    FCoreObjectPtr Acquire(double SampleRate, int32 BlockSize);
+
+  private:
+    struct FKey
+    {
+        double SampleRate;
+        int32 BlockSize;
+
+        bool operator==(const FKey& Other) const { return SampleRate == Other.SampleRate && BlockSize == Other.BlockSize; }
+        friend uint32 GetTypeHash(const FKey& Key) { return HashCombine(GetTypeHash(Key.SampleRate), GetTypeHash(Key.BlockSize)); }
+    };
+
+    friend void ShutdownCoreObjectPools();
+
+    FCoreObjectPtr Create(const FKey& Key) const;
+    void Refill(const FKey& Key);
+
+    FFactoryFunction FactoryFunction;
+    FCriticalSection Mutex;
+    TMap<FKey, TArray<FCoreObjectPtr>> Ready;
+    TSet<FKey> Refilling;
+};
+
+} // namespace RNBOMetasound
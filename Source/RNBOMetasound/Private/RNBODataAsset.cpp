@@ -0,0 +1,78 @@
+#include "RNBODataAsset.h"
+#include "RNBOWaveCache.h"
+
+#include "MetasoundDataTypeRegistrationMacro.h"
+
+REGISTER_METASOUND_DATATYPE(RNBOMetasound::FDataAsset, "RNBODataAsset", Metasound::ELiteralType::UObjectProxy, URNBODataAsset);
+
+namespace RNBOMetasound {
+
+FDecodedWavePtr FBakedData::GetFloat64() const
+{
+    FScopeLock Guard(&Float64Mutex);
+    if (!Float64.IsValid() && Float32.IsValid()) {
+        FDecodedWavePtr Wave = MakeDecodedWave();
+        const int32 Count = Float32->Num();
+        Wave->Samples.SetNumUninitialized(Count * sizeof(double) / sizeof(float));
+        double* Values = reinterpret_cast<double*>(Wave->Samples.GetData());
+        for (int32 i = 0; i < Count; i++) {
+            Values[i] = static_cast<double>(Float32->Samples[i]);
+        }
+        Wave->NumChannels = 1;
+        Float64 = MoveTemp(Wave);
+    }
+    return Float64;
+}
+
+FDataAsset::FDataAsset(const TSharedPtr<Audio::IProxyData>& InInitData)
+{
+    if (InInitData.IsValid() && InInitData->CheckTypeCast<FDataAssetProxy>()) {
+        Proxy = MakeShared<FDataAssetProxy, ESPMode::ThreadSafe>(InInitData->GetAs<FDataAssetProxy>());
+    }
+}
+
+} // namespace RNBOMetasound
+
+TSharedPtr<Audio::IProxyData> URNBODataAsset::CreateProxyData(const Audio::FProxyDataInitParams& InitParams)
+{
+    // every proxy made from this asset shares the same values until the asset is edited
+    // in the editor the curve can also be edited without this asset knowing
+    if (!Baked.IsValid() || (GIsEditor && Curve != nullptr)) {
+        Baked = Bake();
+    }
+    return MakeShared<RNBOMetasound::FDataAssetProxy, ESPMode::ThreadSafe>(Baked);
+}
+
+#if WITH_EDITOR
+void URNBODataAsset::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+    Super::PostEditChangeProperty(PropertyChangedEvent);
+    // nodes already built keep the old values, new ones pick up the change
+    Baked.Reset();
+}
+#endif
+
+RNBOMetasound::FBakedDataPtr URNBODataAsset::Bake() const
+{
+    RNBOMetasound::FDecodedWavePtr Wave = RNBOMetasound::MakeDecodedWave();
+    Wave->NumChannels = 1;
+    if (Values.Num() > 0) {
+        Wave->Samples = Values;
+    }
+    else if (Curve != nullptr) {
+        float MinTime = 0.0f;
+        float MaxTime = 0.0f;
+        Curve->GetTimeRange(MinTime, MaxTime);
+        const int32 Count = FMath::Max(1, CurveSamples);
+        Wave->Samples.SetNumUninitialized(Count);
+        for (int32 i = 0; i < Count; i++) {
+            const float Alpha = Count > 1 ? static_cast<float>(i) / static_cast<float>(Count - 1) : 0.0f;
+            Wave->Samples[i] = Curve->GetFloatValue(FMath::Lerp(MinTime, MaxTime, Alpha));
+        }
+    }
+
+    // only the floats, doubles are made on demand, see FBakedData::GetFloat64
+    TSharedRef<RNBOMetasound::FBakedData, ESPMode::ThreadSafe> Data = MakeShared<RNBOMetasound::FBakedData, ESPMode::ThreadSafe>();
+    Data->Float32 = MoveTemp(Wave);
+    return Data;
+}
@@ -2,12 +2,18 @@
 
 #include "RNBOMetasound.h"
 #include "RNBOTransport.h"
+#include "RNBOWaveCache.h"
+#include "RNBOWaveLoader.h"
+#include "RNBOCoreObjectPool.h"
 #include "MetasoundFrontendModuleRegistrationMacros.h"
 
 void FRNBOMetasoundModule::StartupModule()
 {
     // This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
     METASOUND_REGISTER_ITEMS_IN_MODULE
+    RNBOMetasound::StartWaveReclaim();
+    RNBOMetasound::StartWaveLoader();
+    RNBOMetasound::StartCoreObjectPools();
 }
 
 void FRNBOMetasoundModule::ShutdownModule()
@@ -15,6 +21,9 @@ void FRNBOMetasoundModule::ShutdownModule()
     // This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
     // we call this function before unloading the module.
     METASOUND_UNREGISTER_ITEMS_IN_MODULE
+    RNBOMetasound::ShutdownCoreObjectPools();
+    RNBOMetasound::StopWaveLoader();
+    RNBOMetasound::StopWaveReclaim();
 }
 
 IMPLEMENT_MODULE(FRNBOMetasoundModule, RNBOMetasound)
@@ -1,307 +1,505 @@
 #include "RNBOOperator.h"
-
-namespace {
-UE::Tasks::FPipe AsyncTaskPipe{ TEXT("RNBODatarefLoader") };
-FCriticalSection AsyncTaskPipeMutex;
-} // namespace
+#include "RNBOWaveLoader.h"
+#include <cstring>
 
 namespace RNBOMetasound {
 
+const FEmbeddedBuffer* FEmbeddedBuffers::Find(const char* id) const
+{
+    for (size_t i = 0; i < Count; i++) {
+        if (std::strcmp(Buffers[i].Id, id) == 0) {
+            return &Buffers[i];
+        }
+    }
+    return nullptr;
+}
+
+bool IsConstantInput(const Metasound::FInputVertexInterfaceData& VertexData, const Metasound::FVertexName& Name)
+{
+    // a literal is bound as a value, a connection as a read reference
+    const Metasound::FAnyDataReference* Ref = VertexData.FindDataReference(Name);
+    return Ref == nullptr || Ref->GetAccessType() == Metasound::EDataReferenceAccessType::Value;
+}
+
 WaveAssetDataRef::WaveAssetDataRef(
     RNBO::CoreObject& coreObject,
     const char* id,
-    const TCHAR* Name,
+    const Metasound::FVertexName& name,
+    const FDataRefOptions& options,
+    const FEmbeddedBuffer* embedded,
     const Metasound::FOperatorSettings& InSettings,
     const Metasound::FInputVertexInterfaceData& InputCollection)
     : CoreObject(coreObject)
     , Id(id)
+    , Name(name)
+    , Options(options)
     , WaveAsset(InputCollection.GetOrCreateDefaultDataReadReference<Metasound::FWaveAsset>(Name, InSettings))
+    , Embedded(embedded)
+    , RequestPool(2)
 {
+    if (Options.Resample) {
+        Options.Transform.SampleRate = InSettings.GetSampleRate();
+    }
+    // a transform needs the whole wave, so the data can't be bound before it is complete
+    if (Options.Stream && !Options.Transform.IsIdentity()) {
+        UE_LOG(LogMetaSound, Warning, TEXT("RNBO buffer %s: stream is ignored when the buffer is sliced, resampled or has channels selected"), *Name.ToString());
+        Options.Stream = false;
+    }
+    // the streamed block is shared and still being written by the loader, a copy would lose the patch's writes to the decoder
+    if (Options.Stream && !Options.ReadOnly) {
+        UE_LOG(LogMetaSound, Warning, TEXT("RNBO buffer %s: stream is ignored unless the buffer is declared readonly"), *Name.ToString());
+        Options.Stream = false;
+    }
+    // the patch works out of the box, a wave asset bound later replaces this
+    if (Embedded != nullptr) {
+        if (!Options.ReadOnly) {
+            EmbeddedCopy = MakeDecodedWave();
+            EmbeddedCopy->Samples.Append(Embedded->Samples, static_cast<int32>(Embedded->NumSamples));
+            EmbeddedCopy->NumChannels = Embedded->NumChannels;
+            EmbeddedCopy->SampleRate = Embedded->SampleRate;
+        }
+        BindEmbedded();
+    }
 }
 
 WaveAssetDataRef::~WaveAssetDataRef()
 {
-    Cleanup.Push(Task);
-    for (auto& t : Cleanup) {
-        if (t.IsValid() && !t.IsCompleted()) {
-            t.Wait();
-        }
+    // never wait on the load, it only holds the request and doesn't touch us or the core object
+    if (Request.IsValid()) {
+        Request->Cancel();
     }
 }
 
-void WaveAssetDataRef::Update()
+void WaveAssetDataRef::UpdateChanged(ELoadPriority Priority)
 {
-    auto WaveProxy = WaveAsset->GetSoundWaveProxy();
+    // pick up whatever the in flight load has decoded so far
+    if (Request.IsValid()) {
+        // read done first, anything published before the load finished is then seen by the poll
+        const bool bDone = Request->IsDone();
+        FDecodedWavePtr Loaded;
+        if (Request->Poll(Loaded)) {
+            Bind(Loaded);
+        }
+        if (bDone) {
+            Request.Reset();
+        }
+    }
+
+    const FSoundWaveProxyPtr& WaveProxy = WaveAsset->GetSoundWaveProxy();
+    if (WaveProxy.Get() == CurrentProxy.Get()) {
+        return;
+    }
+    // holding on to it keeps its address from being reused by another proxy, which Update would miss
+    CurrentProxy = WaveProxy;
+
     if (WaveProxy.IsValid()) {
+        // a new proxy of the same wave, the data bound already is the right one
         auto key = WaveProxy->GetFObjectKey();
         if (key == WaveAssetProxyKey) {
             return;
         }
         WaveAssetProxyKey = key;
 
-        // TODO remove completed tasks from Cleanup
-        // TODO optionally release the existing dataref from the core object to reduce memory usage?
+        // over the memory budget, let go of the old data now rather than keeping it until the new data is in
+        if (FWaveCache::Get().IsOverBudget()) {
+            CoreObject.releaseExternalData(Id);
+            Bound.Reset();
+        }
 
-        if (Task.IsValid() && !Task.IsCompleted()) {
-            Cleanup.Push(Task);
+        // superseded, stop decoding at the next chunk and never publish
+        if (Request.IsValid()) {
+            Request->Cancel();
+            Request.Reset();
         }
 
-        {
-            // Launch probably isn't thread safe so we lock a mutex
-            FScopeLock Guard(&AsyncTaskPipeMutex);
-            Task = AsyncTaskPipe.Launch(
-                UE_SOURCE_LOCATION,
-                [this, WaveProxy]() {
-                    double sr = WaveProxy->GetSampleRate();
-                    size_t chans = WaveProxy->GetNumChannels();
-                    // int32 frames = WaveProxy->GetNumFrames();
-                    // double duration = WaveProxy->GetDuration();
-
-                    FName Format = WaveProxy->GetRuntimeFormat();
-                    IAudioInfoFactory* Factory = IAudioInfoFactoryRegistry::Get().Find(Format);
-                    if (Factory == nullptr) {
-                        UE_LOG(LogMetaSound, Error, TEXT("IAudioInfoFactoryRegistry::Get().Find(%s) failed"), *Format.ToString());
-                        return;
-                    }
-
-                    ICompressedAudioInfo* Decompress = Factory->Create();
-                    FSoundQualityInfo quality;
-                    TArray<uint8> Buf;
-                    int32 ValidBytes = 0;
-                    if (WaveProxy->IsStreaming()) {
-                        if (!Decompress->StreamCompressedInfo(WaveProxy, &quality)) {
-                            UE_LOG(LogMetaSound, Error, TEXT("RNBO Failed to get compressed stream info"));
-                            return;
-                        }
-                        Buf.AddZeroed(quality.SampleDataSize);
-                        Decompress->StreamCompressedData(Buf.GetData(), false, Buf.Num(), ValidBytes);
-                    }
-                    else {
-                        if (!Decompress->ReadCompressedInfo(WaveProxy->GetResourceData(), WaveProxy->GetResourceSize(), &quality)) {
-                            UE_LOG(LogMetaSound, Error, TEXT("RNBO Failed to get compressed info"));
-                            return;
-                        }
-                        Buf.AddZeroed(quality.SampleDataSize);
-                        if (Decompress->ReadCompressedData(Buf.GetData(), false, Buf.Num())) {
-                            ValidBytes = Buf.Num();
-                        }
-                        else {
-                            UE_LOG(LogMetaSound, Error, TEXT("RNBO Failed to read compressed data"));
-                            return;
-                        }
-                    }
-
-                    TArrayView<const int16> Data(reinterpret_cast<const int16*>(Buf.GetData()), Buf.Num() / sizeof(int16));
-
-                    TSharedPtr<TArray<float>> Samples(new TArray<float>());
-                    Samples->Reserve(Data.Num());
-
-                    const float div = static_cast<float>(INT16_MAX);
-                    for (auto i = 0; i < Data.Num(); i++) {
-                        Samples->Push(static_cast<float>(Data[i]) / div);
-                    }
-                    size_t SizeInBytes = Buf.Num();
-                    char* DataPtr = reinterpret_cast<char*>(Samples->GetData());
-
-                    RNBO::Float32AudioBuffer bufferType(chans, sr);
-                    CoreObject.setExternalData(Id, DataPtr, sizeof(float) * static_cast<size_t>(Samples->Num()), bufferType, [Samples](RNBO::ExternalDataId, char*) mutable {
-                        Samples.Reset();
-                    });
-                },
-                UE::Tasks::ETaskPriority::BackgroundNormal);
+        // while the node is constructed, off the audio thread, data another pin or operator already holds or that was prefetched is bound right away
+        // a transform or the copy a writable pin needs is made here too
+        // the audio thread never takes the cache's lock, the loader looks in the cache first and publishes what it finds there
+        if (Priority != ELoadPriority::Urgent) {
+            if (FDecodedWavePtr Wave = FWaveCache::Get().FindOrTransform({ key, Options.Transform })) {
+                Bind(Options.ReadOnly ? Wave : CopyWave(*Wave));
+                return;
+            }
+        }
+
+        FWaveLoadRequestRef NewRequest = RequestPool.Acquire(!Options.ReadOnly);
+        Request = NewRequest;
+        FWaveLoader::Get().Submit(NewRequest, WaveProxy, Options.Transform, Options.Stream, Priority);
+    }
+    else if (Embedded != nullptr && WaveAssetProxyKey != FObjectKey()) {
+        // the wave asset was unset, go back to the embedded data
+        WaveAssetProxyKey = FObjectKey();
+        if (Request.IsValid()) {
+            Request->Cancel();
+            Request.Reset();
         }
+        BindEmbedded();
     }
 }
 
-bool IsBoolParam(const RNBO::Json& p)
+namespace {
+// the release callback of bound data, holds a bind on the wave until it is called or destroyed
+// a single pointer with noexcept copies fits in the small buffer of std::function, so binding doesn't allocate
+class FWaveBinding
 {
-    if (p["steps"].get<int>() == 2 && p["enumValues"].is_array()) {
-        auto e = p["enumValues"];
-        return e[0].is_number() && e[1].is_number() && e[0].get<float>() == 0.0f && e[1].get<float>() == 1.0f;
+  public:
+    explicit FWaveBinding(FDecodedWave* InWave) noexcept
+        : Wave(InWave)
+    {
+        Wave->AddBind();
+    }
+    FWaveBinding(const FWaveBinding& Other) noexcept
+        : Wave(Other.Wave)
+    {
+        if (Wave != nullptr) {
+            Wave->AddBind();
+        }
+    }
+    FWaveBinding(FWaveBinding&& Other) noexcept
+        : Wave(Other.Wave)
+    {
+        Other.Wave = nullptr;
+    }
+    FWaveBinding& operator=(const FWaveBinding&) = delete;
+    FWaveBinding& operator=(FWaveBinding&&) = delete;
+    ~FWaveBinding() { Release(); }
+
+    void operator()(RNBO::ExternalDataId, char*) noexcept { Release(); }
+
+  private:
+    void Release() noexcept
+    {
+        if (Wave != nullptr) {
+            Wave->ReleaseBind();
+            Wave = nullptr;
+        }
     }
-    return false;
-}
 
-bool IsIntParam(const RNBO::Json& p)
+    FDecodedWave* Wave;
+};
+} // namespace
+
+void BindWave(RNBO::CoreObject& CoreObject, const char* Id, FDecodedWavePtr Wave)
 {
-    return !IsBoolParam(p) && p["isEnum"].get<bool>();
+    RNBO::Float32AudioBuffer bufferType(Wave->NumChannels, Wave->SampleRate);
+    // RNBO wants mutable data, shared or mapped data is only bound to datarefs the patch doesn't write to
+    char* DataPtr = reinterpret_cast<char*>(const_cast<float*>(Wave->GetData()));
+    CoreObject.setExternalData(Id, DataPtr, Wave->SizeInBytes(), bufferType, FWaveBinding(Wave.Get()));
 }
 
-bool IsFloatParam(const RNBO::Json& p)
+void WaveAssetDataRef::Bind(FDecodedWavePtr Wave)
 {
-    return !(IsBoolParam(p) || IsIntParam(p));
+    // dropping the previous one only retires it if nothing else holds it, see MakeDecodedWave
+    Bound = MoveTemp(Wave);
+    BindWave(CoreObject, Id, Bound);
 }
 
-bool IsInputParam(const RNBO::Json& p)
+WaveBankDataRef::WaveBankDataRef(
+    RNBO::CoreObject& coreObject,
+    const char* id,
+    const Metasound::FVertexName& name,
+    const Metasound::FVertexName& indexName,
+    const FDataRefOptions& options,
+    const Metasound::FOperatorSettings& InSettings,
+    const Metasound::FInputVertexInterfaceData& InputCollection)
+    : CoreObject(coreObject)
+    , Id(id)
+    , Name(name)
+    , IndexName(indexName)
+    , Transform(options.Transform)
+    , ReadOnly(options.ReadOnly)
+    , Waves(InputCollection.GetOrCreateDefaultDataReadReference<TArray<Metasound::FWaveAsset>>(name, InSettings))
+    , BankIndex(InputCollection.GetOrCreateDefaultDataReadReference<int32>(indexName, InSettings))
+    , RequestPool(ReservedMembers)
 {
-    if (p["meta"].is_object() && p["meta"]["in"].is_boolean()) {
-        return p["meta"]["in"].get<bool>();
+    if (options.Resample) {
+        Transform.SampleRate = InSettings.GetSampleRate();
     }
-    // default true
-    return true;
+    Proxies.Reserve(ReservedMembers);
+    Keys.Reserve(ReservedMembers);
+    Decoded.Reserve(ReservedMembers);
+    Requests.Reserve(ReservedMembers);
 }
 
-bool IsOutputParam(const RNBO::Json& p)
+WaveBankDataRef::~WaveBankDataRef()
 {
-    if (p["meta"].is_object() && p["meta"]["out"].is_boolean()) {
-        return p["meta"]["out"].get<bool>();
+    for (auto& Request : Requests) {
+        if (Request.IsValid()) {
+            Request->Cancel();
+        }
     }
-    // default false
-    return false;
 }
 
-std::unordered_map<RNBO::MessageTag, FRNBOMetasoundParam> FRNBOMetasoundParam::InportTrig(const RNBO::Json& desc)
+void WaveBankDataRef::Update(ELoadPriority Priority)
 {
-    std::unordered_map<RNBO::MessageTag, FRNBOMetasoundParam> params;
-    for (auto& p : desc["inports"]) {
-        std::string tag = p["tag"];
-        std::string description = tag;
-        std::string displayName = tag;
-        if (p.contains("meta")) {
-            // TODO get description and display name
-
-            // TODO
-            /*
-               if (p["meta"].contains("trigger") && p["meta"]["trigger"].is_bool() && p["meta"]["trigger"].get<bool>()) {
-               }
-               */
+    if (NumInFlight > 0) {
+        NumInFlight = 0;
+        for (int32 i = 0; i < Requests.Num(); i++) {
+            FWaveLoadRequestPtr& Request = Requests[i];
+            if (Request.IsValid()) {
+                const bool bDone = Request->IsDone();
+                FDecodedWavePtr Loaded;
+                if (Request->Poll(Loaded)) {
+                    Decoded[i] = Loaded;
+                }
+                if (bDone) {
+                    Request.Reset();
+                }
+                else {
+                    NumInFlight++;
+                }
+            }
         }
-        RNBO::MessageTag id = RNBO::TAG(tag.c_str());
-        params.emplace(
-            id,
-            FRNBOMetasoundParam(FString(tag.c_str()), FText::AsCultureInvariant(description.c_str()), FText::AsCultureInvariant(displayName.c_str())));
     }
 
-    return params;
+    const TArray<Metasound::FWaveAsset>& Members = *Waves;
+    if (Members.Num() == 0) {
+        if (Proxies.Num() != 0) {
+            UpdateMembers(Priority);
+        }
+        return;
+    }
+
+    // wraps around so a counter can drive round robin playback
+    int32 Selected = *BankIndex % Members.Num();
+    if (Selected < 0) {
+        Selected += Members.Num();
+    }
+
+    // the members are only walked when the array changed, a member replaced in place is picked up once it is selected
+    if (Members.GetData() != MembersData || Members.Num() != Proxies.Num() || Members[Selected].GetSoundWaveProxy().Get() != Proxies[Selected].Get()) {
+        MembersData = Members.GetData();
+        UpdateMembers(Priority);
+    }
+
+    // the member is already decoded and held by Decoded, so this is only a pointer swap in the core object
+    // binding doesn't allocate, see BindWave
+    // until the selected member is decoded the previous one stays bound
+    const FDecodedWavePtr& Wave = Decoded[Selected];
+    if (Wave.IsValid() && Wave != Bound) {
+        Bound = Wave;
+        BindWave(CoreObject, Id, Wave);
+    }
 }
 
-std::unordered_map<RNBO::MessageTag, FRNBOMetasoundParam> FRNBOMetasoundParam::OutportTrig(const RNBO::Json& desc)
+void WaveBankDataRef::UpdateMembers(ELoadPriority Priority)
 {
-    std::unordered_map<RNBO::MessageTag, FRNBOMetasoundParam> params;
-    for (auto& p : desc["outports"]) {
-        std::string tag = p["tag"];
-        std::string description = tag;
-        std::string displayName = tag;
-        if (p.contains("meta")) {
-            // TODO get description and display name
-
-            // TODO
-            /*
-               if (p["meta"].contains("trigger") && p["meta"]["trigger"].is_bool() && p["meta"]["trigger"].get<bool>()) {
-               }
-               */
+    const TArray<Metasound::FWaveAsset>& Members = *Waves;
+    if (Members.Num() != Proxies.Num()) {
+        for (int32 i = Members.Num(); i < Requests.Num(); i++) {
+            if (Requests[i].IsValid()) {
+                Requests[i]->Cancel();
+            }
         }
-        RNBO::MessageTag id = RNBO::TAG(tag.c_str());
-        params.emplace(
-            id,
-            FRNBOMetasoundParam(FString(tag.c_str()), FText::AsCultureInvariant(description.c_str()), FText::AsCultureInvariant(displayName.c_str())));
+        Proxies.SetNum(Members.Num());
+        Keys.SetNum(Members.Num());
+        Decoded.SetNum(Members.Num());
+        Requests.SetNum(Members.Num());
     }
 
-    return params;
+    for (int32 i = 0; i < Members.Num(); i++) {
+        // a pointer compare, no reference count traffic for members that didn't change
+        const FSoundWaveProxyPtr& WaveProxy = Members[i].GetSoundWaveProxy();
+        if (WaveProxy.Get() == Proxies[i].Get()) {
+            continue;
+        }
+        Proxies[i] = WaveProxy;
+        const FObjectKey Key = WaveProxy.IsValid() ? WaveProxy->GetFObjectKey() : FObjectKey();
+        if (Key == Keys[i]) {
+            continue;
+        }
+        Keys[i] = Key;
+        if (Requests[i].IsValid()) {
+            Requests[i]->Cancel();
+            Requests[i].Reset();
+        }
+        Decoded[i].Reset();
+        if (!WaveProxy.IsValid()) {
+            continue;
+        }
+        // the cache is only looked at here off the audio thread, the loader does it otherwise
+        if (ReadOnly && Priority != ELoadPriority::Urgent) {
+            if (FDecodedWavePtr Wave = FWaveCache::Get().Find({ Key, Transform })) {
+                Decoded[i] = Wave;
+                continue;
+            }
+        }
+        FWaveLoadRequestRef NewRequest = RequestPool.Acquire(!ReadOnly);
+        Requests[i] = NewRequest;
+        FWaveLoader::Get().Submit(NewRequest, WaveProxy, Transform, false, Priority);
+    }
+
+    NumInFlight = 0;
+    for (auto& Request : Requests) {
+        NumInFlight += Request.IsValid() ? 1 : 0;
+    }
 }
 
-std::vector<FRNBOMetasoundParam> FRNBOMetasoundParam::InputAudio(const RNBO::Json& desc)
+void WaveAssetDataRef::BindEmbedded()
 {
-    // TODO param~
-    return Signals(desc, "inlets");
+    Bound.Reset();
+    // kept for the life of the node, what the patch wrote into it is still there when the wave asset is cleared again
+    if (EmbeddedCopy.IsValid()) {
+        BindWave(CoreObject, Id, EmbeddedCopy);
+        return;
+    }
+    RNBO::Float32AudioBuffer bufferType(Embedded->NumChannels, Embedded->SampleRate);
+    // RNBO wants mutable data, a readonly dataref is never written to
+    char* DataPtr = reinterpret_cast<char*>(const_cast<float*>(Embedded->Samples));
+    // the data lives as long as the module, there is nothing to release
+    CoreObject.setExternalData(Id, DataPtr, sizeof(float) * Embedded->NumSamples, bufferType, [](RNBO::ExternalDataId, char*) {});
 }
 
-std::vector<FRNBOMetasoundParam> FRNBOMetasoundParam::OutputAudio(const RNBO::Json& desc)
+DataAssetDataRef::DataAssetDataRef(
+    RNBO::CoreObject& coreObject,
+    const char* id,
+    const Metasound::FVertexName& name,
+    const FDataRefOptions& options,
+    const Metasound::FOperatorSettings& InSettings,
+    const Metasound::FInputVertexInterfaceData& InputCollection)
+    : CoreObject(coreObject)
+    , Id(id)
+    , Name(name)
+    , BufferType(options.BufferType)
+    , SampleRate(InSettings.GetSampleRate())
+    , Data(InputCollection.GetOrCreateDefaultDataReadReference<FDataAsset>(name, InSettings))
 {
-    return Signals(desc, "outlets");
 }
 
-std::vector<FRNBOMetasoundParam> FRNBOMetasoundParam::DataRef(const RNBO::Json& desc)
+void DataAssetDataRef::UpdateChanged()
 {
-    std::vector<FRNBOMetasoundParam> params;
-    for (auto& p : desc["externalDataRefs"]) {
-        // only supporting buffer~ for now
-        if (p.contains("tag") && p["tag"].get<std::string>() != "buffer~") {
-            continue;
-        }
-        std::string id = p["id"];
-        std::string description = id;
-        std::string displayName = id;
-        params.emplace_back(FString(id.c_str()), FText::AsCultureInvariant(description.c_str()), FText::AsCultureInvariant(displayName.c_str()));
+    CurrentProxy = Data->GetProxy();
+    FBakedDataPtr Baked = CurrentProxy.IsValid() ? CurrentProxy->GetData() : nullptr;
+    if (!Baked.IsValid() || !Baked->Float32.IsValid() || Baked->Float32->Num() == 0) {
+        // back to whatever the patch has on its own
+        CoreObject.releaseExternalData(Id);
+        return;
+    }
+
+    // only readonly data objects get a pin, so the values are never written to
+    // bound like waves, the callback holds a bind and the values are reclaimed in the background, see BindWave
+    FDecodedWavePtr Wave = BufferType == EDataBufferType::Float64 ? Baked->GetFloat64() : Baked->Float32;
+    char* DataPtr = reinterpret_cast<char*>(const_cast<float*>(Wave->GetData()));
+    switch (BufferType) {
+        case EDataBufferType::Float64:
+            CoreObject.setExternalData(Id, DataPtr, Wave->SizeInBytes(), RNBO::Float64Buffer(1, SampleRate), FWaveBinding(Wave.Get()));
+            break;
+        case EDataBufferType::Untyped:
+            CoreObject.setExternalData(Id, DataPtr, Wave->SizeInBytes(), RNBO::UntypedDataBuffer(), FWaveBinding(Wave.Get()));
+            break;
+        default:
+            CoreObject.setExternalData(Id, DataPtr, Wave->SizeInBytes(), RNBO::Float32Buffer(1, SampleRate), FWaveBinding(Wave.Get()));
+            break;
+    }
+}
+
+std::unordered_map<RNBO::MessageTag, FRNBOMetasoundParam> FRNBOMetasoundParam::Ports(const FPortDesc* ports, size_t count)
+{
+    std::unordered_map<RNBO::MessageTag, FRNBOMetasoundParam> params;
+    for (size_t i = 0; i < count; i++) {
+        const char* tag = ports[i].Tag;
+        // TODO get description and display name from meta
+        RNBO::MessageTag id = RNBO::TAG(tag);
+        params.emplace(
+            id,
+            FRNBOMetasoundParam(FString(tag), FText::AsCultureInvariant(tag), FText::AsCultureInvariant(tag)));
     }
 
     return params;
 }
 
-bool FRNBOMetasoundParam::MIDIIn(const RNBO::Json& desc)
+std::vector<FRNBOMetasoundParam> FRNBOMetasoundParam::InputAudio(const FSignalDesc* signals, size_t count, const FParamSignalDesc* paramSignals, size_t paramCount)
 {
-    return desc["numMidiInputPorts"].get<int>() > 0;
+    std::vector<FRNBOMetasoundParam> params = Signals(signals, count);
+    // the pins of param~ signal inlets follow the in~ pins, where they go in the core object's inputs is their Channel
+    for (size_t i = 0; i < paramCount; i++) {
+        const FParamSignalDesc& p = paramSignals[i];
+        params.emplace_back(FString(p.Tag), FText::AsCultureInvariant(p.Tooltip), FText::AsCultureInvariant(p.DisplayName), 0.0f);
+    }
+    return params;
 }
 
-bool FRNBOMetasoundParam::MIDIOut(const RNBO::Json& desc)
+std::vector<FRNBOMetasoundParam> FRNBOMetasoundParam::OutputAudio(const FSignalDesc* signals, size_t count)
 {
-    return desc["numMidiOutputPorts"].get<int>() > 0;
+    return Signals(signals, count);
 }
 
-std::vector<FRNBOMetasoundParam> FRNBOMetasoundParam::Signals(const RNBO::Json& desc, std::string selector)
+std::vector<FRNBOMetasoundParam> FRNBOMetasoundParam::DataRef(const FDataRefDesc* refs, size_t count)
 {
     std::vector<FRNBOMetasoundParam> params;
+    for (size_t i = 0; i < count; i++) {
+        const char* id = refs[i].Id;
+        params.emplace_back(FString(id), FText::AsCultureInvariant(id), FText::AsCultureInvariant(id));
+    }
 
-    const std::string sig("signal");
-    for (auto& p : desc[selector]) {
-        if (p.contains("type") && sig.compare(p["type"].get<std::string>()) == 0) {
-            std::string name = p["tag"].get<std::string>();
-            std::string tooltip = name;
-            std::string displayName = name;
-
-            // read comment and populate displayName if it exists
-            if (p.contains("comment") && p["comment"].is_string()) {
-                displayName = p["comment"].get<std::string>();
-            }
-            if (p.contains("meta") && p["meta"].is_object()) {
-                const RNBO::Json& meta = p["meta"];
-                if (meta.contains("displayname") && meta["displayname"].is_string()) {
-                    displayName = meta["displayname"].get<std::string>();
-                }
-                if (meta.contains("tooltip") && meta["tooltip"].is_string()) {
-                    tooltip = meta["tooltip"].get<std::string>();
-                }
-            }
+    return params;
+}
 
-            params.emplace_back(FString(name.c_str()), FText::AsCultureInvariant(tooltip.c_str()), FText::AsCultureInvariant(displayName.c_str()), 0.0f);
+std::unordered_map<size_t, FRNBOMetasoundParam> FRNBOMetasoundParam::DataRefIndex(const FDataRefDesc* refs, size_t count)
+{
+    std::unordered_map<size_t, FRNBOMetasoundParam> params;
+    for (size_t i = 0; i < count; i++) {
+        if (!refs[i].Bank) {
+            continue;
         }
+        FString name = FString(refs[i].Id) + TEXT(" Index");
+        params.insert({ i, FRNBOMetasoundParam(name, FText::AsCultureInvariant(name), FText::AsCultureInvariant(name)) });
     }
 
     return params;
 }
 
-void FRNBOMetasoundParam::NumericParams(const RNBO::Json& desc, std::function<void(const RNBO::Json& param, RNBO::ParameterIndex index, const std::string& name, const std::string& displayName, const std::string& id)> func)
+std::vector<FDataRefOptions> FRNBOMetasoundParam::DataRefOptions(const FDataRefDesc* refs, size_t count)
 {
-    for (auto& p : desc["parameters"]) {
-        if (p["type"].get<std::string>().compare("ParameterTypeNumber") != 0) {
-            continue;
-        }
-        if (p.contains("visible") && p["visible"].get<bool>() == false) {
-            continue;
+    std::vector<FDataRefOptions> options;
+    for (size_t i = 0; i < count; i++) {
+        const FDataRefDesc& r = refs[i];
+        FDataRefOptions o;
+        o.Index = r.Index;
+        o.Kind = r.Kind;
+        o.BufferType = r.BufferType;
+        o.ReadOnly = r.ReadOnly;
+        o.Stream = r.Stream;
+        o.Transform.StartFrame = r.StartFrame;
+        o.Transform.EndFrame = r.EndFrame;
+        o.Transform.Channel = r.Channel;
+        o.Transform.Downmix = r.Downmix;
+        o.Resample = r.Resample;
+        o.Bank = r.Bank;
+        if (r.Share != nullptr) {
+            o.Share = FName(UTF8_TO_TCHAR(r.Share));
         }
-        RNBO::ParameterIndex index = static_cast<RNBO::ParameterIndex>(p["index"].get<int>());
-        std::string name = p["name"].get<std::string>();
-        std::string displayName = p["displayName"].get<std::string>();
-        if (displayName.size() == 0) {
-            displayName = name;
-        }
-        std::string id = p["paramId"].get<std::string>();
-        func(p, index, name, displayName, id);
+        o.ShareFrames = r.ShareFrames;
+        o.ShareChannels = r.ShareChannels;
+        options.push_back(o);
     }
+
+    return options;
 }
 
-std::unordered_map<RNBO::ParameterIndex, FRNBOMetasoundParam> FRNBOMetasoundParam::NumericParamsFiltered(const RNBO::Json& desc, std::function<bool(const RNBO::Json& p)> filter)
+std::vector<FRNBOMetasoundParam> FRNBOMetasoundParam::Signals(const FSignalDesc* signals, size_t count)
 {
-    std::unordered_map<RNBO::ParameterIndex, FRNBOMetasoundParam> params;
-    NumericParams(desc, [&params, &filter](const RNBO::Json& p, RNBO::ParameterIndex index, const std::string& name, const std::string& displayName, const std::string& id) {
+    std::vector<FRNBOMetasoundParam> params;
+    for (size_t i = 0; i < count; i++) {
+        const FSignalDesc& p = signals[i];
+        params.emplace_back(FString(p.Tag), FText::AsCultureInvariant(p.Tooltip), FText::AsCultureInvariant(p.DisplayName), 0.0f);
+    }
+
+    return params;
+}
+
+std::unordered_map<RNBO::ParameterIndex, FRNBOMetasoundParam> FRNBOMetasoundParam::NumericParams(const FParamDesc* params, size_t count, TFunctionRef<bool(const FParamDesc& p)> filter)
+{
+    std::unordered_map<RNBO::ParameterIndex, FRNBOMetasoundParam> filtered;
+    for (size_t i = 0; i < count; i++) {
+        const FParamDesc& p = params[i];
         if (filter(p)) {
-            float initialValue = p["initialValue"].get<float>();
-            params.emplace(
-                index,
-                FRNBOMetasoundParam(FString(name.c_str()), FText::AsCultureInvariant(id.c_str()), FText::AsCultureInvariant(displayName.c_str()), initialValue));
+            filtered.emplace(
+                p.Index,
+                FRNBOMetasoundParam(FString(p.Name), FText::AsCultureInvariant(p.Id), FText::AsCultureInvariant(p.DisplayName), p.InitialValue));
         }
-    });
-    return params;
+    }
+    return filtered;
 }
 
 } // namespace RNBOMetasound
@@ -2,6 +2,11 @@
 
 #include "MetasoundFacade.h"
 #include "RNBOTransport.h"
+#include "RNBOWaveCache.h"
+#include "RNBOWaveLoader.h"
+#include "RNBOSharedBuffers.h"
+#include "RNBODataAsset.h"
+#include "RNBOCoreObjectPool.h"
 
 // visual studio warnings we're having trouble with
 #pragma warning(disable : 4800 4065 4668 4804 4018 4060 4554 4018)
@@ -14,9 +19,11 @@
 #include "MetasoundLog.h"
 
 #include "Internationalization/Text.h"
+#include <array>
 #include <unordered_map>
 
 #include "DSP/BufferVectorOperations.h"
+#include "DSP/FloatArrayMath.h"
 #include "DSP/ConvertDeinterleave.h"
 #include "DSP/MultichannelBuffer.h"
 #include "DSP/MultichannelLinearResampler.h"
@@ -30,7 +37,6 @@
 
 #include "AudioDecompress.h"
 #include "Interfaces/IAudioFormat.h"
-#include "Tasks/Pipe.h"
 
 namespace RNBOMetasound {
 
@@ -41,37 +47,270 @@ METASOUND_PARAM(ParamMIDIOut, "MIDI Out", "MIDI data output.")
 
 using Metasound::FDataVertexMetadata;
 
+enum class EDataRefKind : uint8
+{
+    // buffer~, takes wave assets
+    Wave,
+    // data, takes RNBO data assets
+    Data
+};
+
+enum class EDataBufferType : uint8
+{
+    Float32,
+    Float64,
+    Untyped
+};
+
+// per dataref options, read from the description and the buffer~ @meta
+struct FDataRefOptions
+{
+    // index of the dataref in the core object, not every dataref in the description gets a pin
+    RNBO::DataRefIndex Index = 0;
+    EDataRefKind Kind = EDataRefKind::Wave;
+    EDataBufferType BufferType = EDataBufferType::Float32;
+
+    // the patch never writes to the data, so it can be bound to memory shared with other pins and nodes
+    // otherwise every node gets its own copy
+    bool ReadOnly = false;
+    // bind the buffer as soon as its first chunk is decoded and fill in the rest behind it
+    bool Stream = false;
+    // slice and channel selection or downmix, applied once when the wave is loaded
+    FWaveTransform Transform;
+    // also resample to the operator's sample rate when the wave is loaded
+    bool Resample = false;
+    // an array of wave assets, all decoded up front, and an index pin selecting which one is bound
+    bool Bank = false;
+    // bound to the named shared buffer instead of a wave asset, there is no pin
+    FName Share;
+    // size of the shared buffer, 0 frames for one second at the operator's sample rate
+    int32 ShareFrames = 0;
+    int32 ShareChannels = 1;
+};
+
+// bind decoded data to a dataref, the data isn't reclaimed until the core object releases it
+// the caller keeps a shared pointer to it while it wants it bound, that is what lets other nodes find it in the cache
+void BindWave(RNBO::CoreObject& CoreObject, const char* Id, FDecodedWavePtr Wave);
+
+// buffer~ data read from the export's @file dependencies and compiled into the module, for buffer~s with @meta embed:true
+// it lives in read only memory, only readonly datarefs bind it directly, the others bind a copy of their own
+struct FEmbeddedBuffer
+{
+    const char* Id;
+    const float* Samples;
+    size_t NumSamples;
+    int32 NumChannels;
+    double SampleRate;
+};
+
+struct FEmbeddedBuffers
+{
+    const FEmbeddedBuffer* Buffers;
+    size_t Count;
+
+    // nullptr if the buffer with this id wasn't embedded
+    const FEmbeddedBuffer* Find(const char* id) const;
+};
+
 struct WaveAssetDataRef
 {
     RNBO::CoreObject& CoreObject;
     const char* Id;
+    Metasound::FVertexName Name;
     RNBO::DataRefIndex Index;
+    FDataRefOptions Options; // with the transform's sample rate set to the operator's when resampling
     Metasound::FWaveAssetReadRef WaveAsset;
+    FSoundWaveProxyPtr CurrentProxy; // as of the last update
     FObjectKey WaveAssetProxyKey;
-    UE::Tasks::FTask Task;
-    TArray<UE::Tasks::FTask> Cleanup; // make sure not to leave running tasks dangling
+    FWaveLoadRequestPtr Request; // in flight load, if any
+    const FEmbeddedBuffer* Embedded; // bound while no wave asset is, may be nullptr
+    FDecodedWavePtr EmbeddedCopy; // what is bound instead of Embedded when the patch may write to it
+    FDecodedWavePtr Bound; // the wave asset's data bound last, if any
+    FWaveLoadRequestPool RequestPool;
 
     WaveAssetDataRef(
         RNBO::CoreObject& coreObject,
         const char* id,
-        const TCHAR* Name,
+        const Metasound::FVertexName& name,
+        const FDataRefOptions& options,
+        const FEmbeddedBuffer* embedded,
         const Metasound::FOperatorSettings& InSettings,
         const Metasound::FInputVertexInterfaceData& InputCollection);
+    // moved into the operator after construction, a copy would cancel the load when the original is destroyed
+    WaveAssetDataRef(WaveAssetDataRef&& other) = default;
     ~WaveAssetDataRef();
-    void Update();
+
+    // binds newly decoded data and starts a load if the wave asset changed
+    // called every block, only a pointer compare unless a load is in flight or the wave asset changed
+    // Urgent is for the audio thread, the load is then submitted to the loader without allocating
+    void Update(ELoadPriority Priority = ELoadPriority::Urgent)
+    {
+        if (!Request.IsValid() && WaveAsset->GetSoundWaveProxy().Get() == CurrentProxy.Get()) {
+            return;
+        }
+        UpdateChanged(Priority);
+    }
+
+  private:
+    void UpdateChanged(ELoadPriority Priority);
+    void Bind(FDecodedWavePtr Wave);
+    void BindEmbedded();
 };
 
-bool IsBoolParam(const RNBO::Json& p);
-bool IsIntParam(const RNBO::Json& p);
-bool IsFloatParam(const RNBO::Json& p);
-bool IsInputParam(const RNBO::Json& p);
-bool IsOutputParam(const RNBO::Json& p);
+// a buffer~ with @meta bank:true, switching between members is just rebinding data that is already decoded
+struct WaveBankDataRef
+{
+    RNBO::CoreObject& CoreObject;
+    const char* Id;
+    Metasound::FVertexName Name;
+    Metasound::FVertexName IndexName;
+    FWaveTransform Transform;
+    bool ReadOnly;
+    Metasound::TDataReadReference<TArray<Metasound::FWaveAsset>> Waves;
+    Metasound::FInt32ReadRef BankIndex;
+
+    // members a bank can have before updating it allocates
+    static constexpr int32 ReservedMembers = 16;
+
+    // per member, as of the last update
+    TArray<FSoundWaveProxyPtr> Proxies;
+    TArray<FObjectKey> Keys;
+    TArray<FDecodedWavePtr> Decoded;
+    TArray<FWaveLoadRequestPtr> Requests;
+    FWaveLoadRequestPool RequestPool;
+    int32 NumInFlight = 0;
+    const Metasound::FWaveAsset* MembersData = nullptr; // the array's data as of the last walk
+    FDecodedWavePtr Bound;
+
+    WaveBankDataRef(
+        RNBO::CoreObject& coreObject,
+        const char* id,
+        const Metasound::FVertexName& name,
+        const Metasound::FVertexName& indexName,
+        const FDataRefOptions& options,
+        const Metasound::FOperatorSettings& InSettings,
+        const Metasound::FInputVertexInterfaceData& InputCollection);
+    WaveBankDataRef(WaveBankDataRef&& other) = default;
+    ~WaveBankDataRef();
+
+    // starts loads for members that changed and binds the selected member once it is decoded
+    // called every block, only polls in flight loads and checks the selected member unless the array changed
+    void Update(ELoadPriority Priority = ELoadPriority::Urgent);
+
+  private:
+    void UpdateMembers(ELoadPriority Priority);
+};
+
+// a data object fed by an RNBO data asset, the values are shared read only with every other node using the asset
+struct DataAssetDataRef
+{
+    RNBO::CoreObject& CoreObject;
+    const char* Id;
+    Metasound::FVertexName Name;
+    EDataBufferType BufferType;
+    double SampleRate;
+    FDataAssetReadRef Data;
+    FDataAssetProxyPtr CurrentProxy; // as of the last update
+
+    DataAssetDataRef(
+        RNBO::CoreObject& coreObject,
+        const char* id,
+        const Metasound::FVertexName& name,
+        const FDataRefOptions& options,
+        const Metasound::FOperatorSettings& InSettings,
+        const Metasound::FInputVertexInterfaceData& InputCollection);
+
+    // binds the asset's values if the asset changed, only a pointer compare otherwise
+    void Update()
+    {
+        if (Data->GetProxy().Get() == CurrentProxy.Get()) {
+            return;
+        }
+        UpdateChanged();
+    }
+
+  private:
+    void UpdateChanged();
+};
+
+// the tables below are generated for each export by RNBOMetasound.Build.cs from its description.json
+// as a Desc struct with ClassName, DisplayName, Transport, MIDIIn, MIDIOut, NumParameters, NumInputChannels
+// and std::arrays of these: Parameters, ParamSignals, Inports, Outports, InputSignals, OutputSignals and DataRefs
+
+enum class EParamType : uint8
+{
+    Float,
+    Int,
+    // @enum 0 1
+    Bool
+};
+
+// a visible numeric parameter with a pin
+struct FParamDesc
+{
+    RNBO::ParameterIndex Index;
+    const char* Name;
+    const char* DisplayName;
+    const char* Id;
+    float InitialValue;
+    EParamType Type;
+    bool Input;
+    bool Output;
+};
+
+// a param~ with a signal inlet, its audio pin is named after the parameter with a ~ appended
+struct FParamSignalDesc
+{
+    RNBO::ParameterIndex Index;
+    const char* Tag;
+    const char* DisplayName;
+    const char* Tooltip;
+    // its signal index, the core object's input it is read from
+    size_t Channel;
+};
+
+struct FPortDesc
+{
+    const char* Tag;
+};
+
+struct FSignalDesc
+{
+    const char* Tag;
+    const char* DisplayName;
+    const char* Tooltip;
+    // the core object's input or output
+    size_t Channel;
+};
+
+// a supported dataref and its options, see FDataRefOptions
+struct FDataRefDesc
+{
+    const char* Id;
+    RNBO::DataRefIndex Index;
+    EDataRefKind Kind;
+    EDataBufferType BufferType;
+    bool ReadOnly;
+    bool Stream;
+    int32 StartFrame;
+    int32 EndFrame;
+    // 0 based, INDEX_NONE for all channels
+    int32 Channel;
+    bool Downmix;
+    bool Resample;
+    bool Bank;
+    // nullptr unless shared
+    const char* Share;
+    int32 ShareFrames;
+    int32 ShareChannels;
+};
 
 class FRNBOMetasoundParam
 {
   public:
     FRNBOMetasoundParam(const FString name, const FText tooltip, const FText displayName, float initialValue = 0.0f)
         : mName(name)
+        , mVertexName(name)
         , mInitialValue(initialValue)
         ,
 #if WITH_EDITOR
@@ -90,59 +329,144 @@ class FRNBOMetasoundParam
     }
 
     const TCHAR* Name() const { return mName.GetCharArray().GetData(); }
+    const Metasound::FVertexName& VertexName() const { return mVertexName; }
     const FText Tooltip() const { return mTooltip; }
     const FText DisplayName() const { return mDisplayName; }
     float InitialValue() const { return mInitialValue; }
 
-    static std::unordered_map<RNBO::MessageTag, FRNBOMetasoundParam> InportTrig(const RNBO::Json& desc);
-    static std::unordered_map<RNBO::MessageTag, FRNBOMetasoundParam> OutportTrig(const RNBO::Json& desc);
-    static std::vector<FRNBOMetasoundParam> InputAudio(const RNBO::Json& desc);
-    static std::vector<FRNBOMetasoundParam> OutputAudio(const RNBO::Json& desc);
-    static std::vector<FRNBOMetasoundParam> DataRef(const RNBO::Json& desc);
-    static bool MIDIIn(const RNBO::Json& desc);
-    static bool MIDIOut(const RNBO::Json& desc);
-    static std::vector<FRNBOMetasoundParam> Signals(const RNBO::Json& desc, std::string selector);
-    static void NumericParams(const RNBO::Json& desc, std::function<void(const RNBO::Json& param, RNBO::ParameterIndex index, const std::string& name, const std::string& displayName, const std::string& id)> func);
-    static std::unordered_map<RNBO::ParameterIndex, FRNBOMetasoundParam> NumericParamsFiltered(const RNBO::Json& desc, std::function<bool(const RNBO::Json& p)> filter);
+    static std::unordered_map<RNBO::MessageTag, FRNBOMetasoundParam> Ports(const FPortDesc* ports, size_t count);
+    static std::vector<FRNBOMetasoundParam> InputAudio(const FSignalDesc* signals, size_t count, const FParamSignalDesc* paramSignals, size_t paramCount);
+    static std::vector<FRNBOMetasoundParam> OutputAudio(const FSignalDesc* signals, size_t count);
+    static std::vector<FRNBOMetasoundParam> DataRef(const FDataRefDesc* refs, size_t count);
+    // keyed on the position in refs, only bank datarefs have an index pin
+    static std::unordered_map<size_t, FRNBOMetasoundParam> DataRefIndex(const FDataRefDesc* refs, size_t count);
+    static std::vector<FDataRefOptions> DataRefOptions(const FDataRefDesc* refs, size_t count);
+    static std::vector<FRNBOMetasoundParam> Signals(const FSignalDesc* signals, size_t count);
+    static std::unordered_map<RNBO::ParameterIndex, FRNBOMetasoundParam> NumericParams(const FParamDesc* params, size_t count, TFunctionRef<bool(const FParamDesc& p)> filter);
 
     const FString mName;
+    const Metasound::FVertexName mVertexName;
     float mInitialValue;
     const FText mTooltip;
     const FText mDisplayName;
 };
 
+// an input pin of a parameter and the value last sent to the core object for it
+template <typename RefType>
+struct TInputParamSlot
+{
+    RNBO::ParameterIndex Index;
+    Metasound::FVertexName Name;
+    RefType Ref;
+    double LastValue;
+};
+
+// an output pin of a parameter
+template <typename RefType>
+struct TOutputParamSlot
+{
+    RNBO::ParameterIndex Index;
+    Metasound::FVertexName Name;
+    RefType Ref;
+};
+
+// the pin of an inport or outport
+template <typename RefType>
+struct TTriggerSlot
+{
+    RNBO::MessageTag Tag;
+    Metasound::FVertexName Name;
+    RefType Ref;
+};
+
+enum class EParamSlotKind : uint8
+{
+    None,
+    Float,
+    Int,
+    Bool
+};
+
+// a pin bound to a literal, or not bound at all, can't change until the inputs are bound again
+bool IsConstantInput(const Metasound::FInputVertexInterfaceData& VertexData, const Metasound::FVertexName& Name);
+
+// where the pins of a parameter live, indexed by parameter index
+struct FParamSlots
+{
+    EParamSlotKind InputKind = EParamSlotKind::None;
+    EParamSlotKind OutputKind = EParamSlotKind::None;
+    uint32 Input = 0;
+    uint32 Output = 0;
+    // param~ signal, INDEX_NONE if the parameter has none
+    int32 Signal = INDEX_NONE;
+};
+
+// the audio pin of a param~, while nothing is connected to it the patch reads the parameter's value from Fill
+struct FParamSignalSlot
+{
+    RNBO::ParameterIndex Index;
+    // of the pin in the input audio
+    size_t Pin;
+    // in the core object's inputs
+    size_t Channel;
+    bool bConnected;
+    // the parameter's value as last sent or reported by the patch, and the value Fill holds
+    double Value;
+    double FilledValue;
+    Audio::FAlignedFloatBuffer Fill;
+};
+
 #undef LOCTEXT_NAMESPACE
 #define LOCTEXT_NAMESPACE "FRNBOOperator"
 
 // https://en.cppreference.com/w/cpp/language/template_parameters
-template <const RNBO::Json& desc, RNBO::PatcherFactoryFunctionPtr (*FactoryFunction)()>
-class FRNBOOperator : public Metasound::TExecutableOperator<FRNBOOperator<desc, FactoryFunction>>
+template <typename Desc, RNBO::PatcherFactoryFunctionPtr (*FactoryFunction)(), const FEmbeddedBuffers& embedded>
+class FRNBOOperator : public Metasound::TExecutableOperator<FRNBOOperator<Desc, FactoryFunction, embedded>>
     , public RNBO::EventHandler
     , public FMidiVoiceGeneratorBase
 {
   private:
-    RNBO::CoreObject CoreObject;
+    // taken from the export's pool, retired through RetireSlot when the operator goes away
+    FCoreObjectPtr CoreObject;
+    TUniquePtr<FRetiredCoreObject> RetireSlot;
     RNBO::TimeConverter Converter = RNBO::TimeConverter(44100.0, 0.0);
     RNBO::ParameterEventInterfaceUniquePtr ParamInterface;
 
     int32 mNumFrames;
     float mSampleRate;
 
-    std::unordered_map<RNBO::ParameterIndex, Metasound::FFloatReadRef> mInputFloatParams;
-    std::unordered_map<RNBO::ParameterIndex, Metasound::FInt32ReadRef> mInputIntParams;
-    std::unordered_map<RNBO::ParameterIndex, Metasound::FBoolReadRef> mInputBoolParams;
-    std::unordered_map<RNBO::MessageTag, Metasound::FTriggerReadRef> mInportTriggerParams;
+    std::vector<TInputParamSlot<Metasound::FFloatReadRef>> mInputFloatParams;
+    std::vector<TInputParamSlot<Metasound::FInt32ReadRef>> mInputIntParams;
+    std::vector<TInputParamSlot<Metasound::FBoolReadRef>> mInputBoolParams;
+    // slots of the pins that aren't constant, only these are checked every block
+    std::vector<uint32> mLiveFloatParams;
+    std::vector<uint32> mLiveIntParams;
+    std::vector<uint32> mLiveBoolParams;
+    // check every slot on the next block, set when the inputs are bound or the patch overrides an input
+    bool bSendAllParams = true;
+    std::vector<TTriggerSlot<Metasound::FTriggerReadRef>> mInportTriggerParams;
     std::vector<WaveAssetDataRef> mDataRefParams;
+    std::vector<WaveBankDataRef> mDataRefBanks;
+    std::vector<DataAssetDataRef> mDataAssetParams;
+    // held for as long as the node lives, see BindWave
+    std::vector<FDecodedWavePtr> mSharedBuffers;
 
     std::vector<Metasound::FAudioBufferReadRef> mInputAudioParams;
-    std::vector<const float*> mInputAudioBuffers;
-
-    std::unordered_map<RNBO::ParameterIndex, Metasound::FFloatWriteRef> mOutputFloatParams;
-    std::unordered_map<RNBO::ParameterIndex, Metasound::FInt32WriteRef> mOutputIntParams;
-    std::unordered_map<RNBO::ParameterIndex, Metasound::FBoolWriteRef> mOutputBoolParams;
-    std::unordered_map<RNBO::MessageTag, Metasound::FTriggerWriteRef> mOutportTriggerParams;
+    // by the core object's input channel, channels without a pin read silence
+    std::array<const float*, Desc::NumInputChannels> mInputAudioBuffers = {};
+    std::vector<FParamSignalSlot> mParamSignals;
+    // read by every unconnected audio input
+    Metasound::FAudioBufferReadRef mSilence;
+
+    std::vector<TOutputParamSlot<Metasound::FFloatWriteRef>> mOutputFloatParams;
+    std::vector<TOutputParamSlot<Metasound::FInt32WriteRef>> mOutputIntParams;
+    std::vector<TOutputParamSlot<Metasound::FBoolWriteRef>> mOutputBoolParams;
+    std::vector<FParamSlots> mParamSlots;
+    std::vector<TTriggerSlot<Metasound::FTriggerWriteRef>> mOutportTriggerParams;
     std::vector<Metasound::FAudioBufferWriteRef> mOutputAudioParams;
-    std::vector<float*> mOutputAudioBuffers;
+    std::array<float*, Desc::OutputSignals.size()> mOutputAudioBuffers = {};
+    // the core object doesn't have the channels the description lists, it is never processed
+    bool bChannelMismatch = false;
 
     TOptional<FTransportReadRef> Transport;
 
@@ -155,118 +479,176 @@ class FRNBOOperator : public Metasound::TExecutableOperator<FRNBOOperator<desc,
     int32 LastTransportNum = 0;
     int32 LastTransportDen = 0;
 
-    static const size_t ParamCount()
+    static FCoreObjectPool& Pool()
+    {
+        static FCoreObjectPool Objects(FactoryFunction);
+        return Objects;
+    }
+
+    // fresh and pooled core objects may not have applied their initial values yet, so they're not asked for the current ones
+    RNBO::ParameterValue InitialValue(RNBO::ParameterIndex index) const
+    {
+        RNBO::ParameterInfo info;
+        CoreObject->getParameterInfo(index, &info);
+        return info.initialValue;
+    }
+
+    static constexpr size_t ParamCount()
+    {
+        return Desc::NumParameters;
+    }
+
+    static std::unordered_map<RNBO::ParameterIndex, FRNBOMetasoundParam> NumericParams(TFunctionRef<bool(const FParamDesc& p)> filter)
     {
-        static const size_t count = desc["parameters"].size();
-        return count;
+        return FRNBOMetasoundParam::NumericParams(Desc::Parameters.data(), Desc::Parameters.size(), filter);
     }
 
     static const std::unordered_map<RNBO::ParameterIndex, FRNBOMetasoundParam>& InputFloatParams()
     {
-        static const auto Params = FRNBOMetasoundParam::NumericParamsFiltered(desc, [](const RNBO::Json& p) -> bool { return IsInputParam(p) && IsFloatParam(p); });
+        static const auto Params = NumericParams([](const FParamDesc& p) -> bool { return p.Input && p.Type == EParamType::Float; });
         return Params;
     }
 
     static const std::unordered_map<RNBO::ParameterIndex, FRNBOMetasoundParam>& InputIntParams()
     {
-        static const auto Params = FRNBOMetasoundParam::NumericParamsFiltered(desc, [](const RNBO::Json& p) -> bool { return IsInputParam(p) && IsIntParam(p); });
+        static const auto Params = NumericParams([](const FParamDesc& p) -> bool { return p.Input && p.Type == EParamType::Int; });
         return Params;
     }
 
     static const std::unordered_map<RNBO::ParameterIndex, FRNBOMetasoundParam>& InputBoolParams()
     {
-        static const auto Params = FRNBOMetasoundParam::NumericParamsFiltered(desc, [](const RNBO::Json& p) -> bool { return IsInputParam(p) && IsBoolParam(p); });
+        static const auto Params = NumericParams([](const FParamDesc& p) -> bool { return p.Input && p.Type == EParamType::Bool; });
         return Params;
     }
 
     static const std::unordered_map<RNBO::ParameterIndex, FRNBOMetasoundParam>& OutputFloatParams()
     {
-        static const auto Params = FRNBOMetasoundParam::NumericParamsFiltered(desc, [](const RNBO::Json& p) -> bool { return IsOutputParam(p) && IsFloatParam(p); });
+        static const auto Params = NumericParams([](const FParamDesc& p) -> bool { return p.Output && p.Type == EParamType::Float; });
         return Params;
     }
 
     static const std::unordered_map<RNBO::ParameterIndex, FRNBOMetasoundParam>& OutputIntParams()
     {
-        static const auto Params = FRNBOMetasoundParam::NumericParamsFiltered(desc, [](const RNBO::Json& p) -> bool { return IsOutputParam(p) && IsIntParam(p); });
+        static const auto Params = NumericParams([](const FParamDesc& p) -> bool { return p.Output && p.Type == EParamType::Int; });
         return Params;
     }
 
     static const std::unordered_map<RNBO::ParameterIndex, FRNBOMetasoundParam>& OutputBoolParams()
     {
-        static const auto Params = FRNBOMetasoundParam::NumericParamsFiltered(desc, [](const RNBO::Json& p) -> bool { return IsOutputParam(p) && IsBoolParam(p); });
+        static const auto Params = NumericParams([](const FParamDesc& p) -> bool { return p.Output && p.Type == EParamType::Bool; });
         return Params;
     }
 
     static const std::unordered_map<RNBO::MessageTag, FRNBOMetasoundParam>& InportTrig()
     {
-        static const std::unordered_map<RNBO::MessageTag, FRNBOMetasoundParam> Params = FRNBOMetasoundParam::InportTrig(desc);
+        static const std::unordered_map<RNBO::MessageTag, FRNBOMetasoundParam> Params = FRNBOMetasoundParam::Ports(Desc::Inports.data(), Desc::Inports.size());
         return Params;
     }
 
     static const std::vector<FRNBOMetasoundParam>& DataRefParams()
     {
-        static const std::vector<FRNBOMetasoundParam> Params = FRNBOMetasoundParam::DataRef(desc);
+        static const std::vector<FRNBOMetasoundParam> Params = FRNBOMetasoundParam::DataRef(Desc::DataRefs.data(), Desc::DataRefs.size());
+        return Params;
+    }
+
+    static const std::unordered_map<size_t, FRNBOMetasoundParam>& DataRefIndexParams()
+    {
+        static const std::unordered_map<size_t, FRNBOMetasoundParam> Params = FRNBOMetasoundParam::DataRefIndex(Desc::DataRefs.data(), Desc::DataRefs.size());
         return Params;
     }
 
+    static const std::vector<FDataRefOptions>& DataRefOptions()
+    {
+        static const std::vector<FDataRefOptions> Options = FRNBOMetasoundParam::DataRefOptions(Desc::DataRefs.data(), Desc::DataRefs.size());
+        return Options;
+    }
+
+    // the core object's input channel of a pin in InputAudioParams
+    static constexpr size_t InputAudioChannel(size_t pin)
+    {
+        return pin < Desc::InputSignals.size() ? Desc::InputSignals[pin].Channel : Desc::ParamSignals[pin - Desc::InputSignals.size()].Channel;
+    }
+
     static const std::vector<FRNBOMetasoundParam>& InputAudioParams()
     {
-        static const std::vector<FRNBOMetasoundParam> Params = FRNBOMetasoundParam::InputAudio(desc);
+        static const std::vector<FRNBOMetasoundParam> Params = FRNBOMetasoundParam::InputAudio(Desc::InputSignals.data(), Desc::InputSignals.size(), Desc::ParamSignals.data(), Desc::ParamSignals.size());
         return Params;
     }
 
     static const std::unordered_map<RNBO::MessageTag, FRNBOMetasoundParam>& OutportTrig()
     {
-        static const std::unordered_map<RNBO::MessageTag, FRNBOMetasoundParam> Params = FRNBOMetasoundParam::OutportTrig(desc);
+        static const std::unordered_map<RNBO::MessageTag, FRNBOMetasoundParam> Params = FRNBOMetasoundParam::Ports(Desc::Outports.data(), Desc::Outports.size());
         return Params;
     }
 
     static const std::vector<FRNBOMetasoundParam>& OutputAudioParams()
     {
-        static const std::vector<FRNBOMetasoundParam> Params = FRNBOMetasoundParam::OutputAudio(desc);
+        static const std::vector<FRNBOMetasoundParam> Params = FRNBOMetasoundParam::OutputAudio(Desc::OutputSignals.data(), Desc::OutputSignals.size());
         return Params;
     }
 
-    static const bool WithTransport()
+    static const Metasound::FVertexName& MIDIInName()
+    {
+        static const Metasound::FVertexName Name(METASOUND_GET_PARAM_NAME(ParamMIDIIn));
+        return Name;
+    }
+
+    static const Metasound::FVertexName& MIDIOutName()
+    {
+        static const Metasound::FVertexName Name(METASOUND_GET_PARAM_NAME(ParamMIDIOut));
+        return Name;
+    }
+
+    static const Metasound::FVertexName& TransportName()
     {
-        const std::string key = "transportUsed";
-        return !desc.contains(key) || desc[key].get<bool>();
+        static const Metasound::FVertexName Name(METASOUND_GET_PARAM_NAME(ParamTransport));
+        return Name;
     }
 
-    static const bool WithMIDIIn()
+    static constexpr bool WithTransport()
     {
-        static const bool v = FRNBOMetasoundParam::FRNBOMetasoundParam::MIDIIn(desc);
-        return v;
+        return Desc::Transport;
     }
 
-    static const bool WithMIDIOut()
+    static constexpr bool WithMIDIIn()
     {
-        static const bool v = FRNBOMetasoundParam::FRNBOMetasoundParam::MIDIOut(desc);
-        return v;
+        return Desc::MIDIIn;
     }
 
+    static constexpr bool WithMIDIOut()
+    {
+        return Desc::MIDIOut;
+    }
+
+    // the paths an export doesn't use are compiled out of Execute
+    static constexpr bool WithParams(bool input)
+    {
+        for (auto& p : Desc::Parameters) {
+            if (input ? p.Input : p.Output) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static constexpr bool WithParamSignals() { return !Desc::ParamSignals.empty(); }
+    static constexpr bool WithInportTrig() { return !Desc::Inports.empty(); }
+    static constexpr bool WithOutportTrig() { return !Desc::Outports.empty(); }
+    static constexpr bool WithDataRefs() { return !Desc::DataRefs.empty(); }
+
   public:
     static const Metasound::FNodeClassMetadata& GetNodeInfo()
     {
         auto InitNodeInfo = []() -> Metasound::FNodeClassMetadata {
-            auto meta = desc["meta"];
-            std::string classname = meta["rnboobjname"];
-            std::string name;
-            std::string description = "RNBO Generated";
-            std::string category = "RNBO";
-
-            if (meta.contains("name")) {
-                name = meta["name"];
-            }
-            if (name.size() == 0 || name.compare("untitled") == 0) {
-                name = classname;
-            }
+            // the display name falls back to the class name at build time
+            const char* description = "RNBO Generated";
+            const char* category = "RNBO";
             // TODO description and category from meta?
 
-            FName ClassName(FString(classname.c_str()));
-            FText DisplayName = FText::AsCultureInvariant(name.c_str());
-            FText Description = FText::AsCultureInvariant(description.c_str());
-            FText Category = FText::AsCultureInvariant(category.c_str());
+            FName ClassName(FString(Desc::ClassName));
+            FText DisplayName = FText::AsCultureInvariant(Desc::DisplayName);
+            FText Description = FText::AsCultureInvariant(description);
+            FText Category = FText::AsCultureInvariant(category);
 
             Metasound::FNodeClassMetadata Info;
             Info.ClassName = { TEXT("UE"), ClassName, TEXT("Audio") };
@@ -308,7 +690,7 @@ class FRNBOOperator : public Metasound::TExecutableOperator<FRNBOOperator<desc,
                 inputs.Add(TInputDataVertex<Metasound::FAudioBuffer>(p.Name(), p.MetaData()));
             }
 
-            if (WithMIDIIn()) {
+            if constexpr (WithMIDIIn()) {
                 inputs.Add(TInputDataVertex<HarmonixMetasound::FMidiStream>(METASOUND_GET_PARAM_NAME_AND_METADATA(ParamMIDIIn)));
             }
 
@@ -346,11 +728,31 @@ class FRNBOOperator : public Metasound::TExecutableOperator<FRNBOOperator<desc,
                 }
             }
 
-            for (auto& p : DataRefParams()) {
-                inputs.Add(TInputDataVertex<Metasound::FWaveAsset>(p.Name(), p.MetaData()));
+            {
+                auto& options = DataRefOptions();
+                auto& indexParams = DataRefIndexParams();
+                auto& params = DataRefParams();
+                for (size_t i = 0; i < params.size(); i++) {
+                    auto& p = params[i];
+                    if (options[i].Kind == EDataRefKind::Data) {
+                        inputs.Add(TInputDataVertex<FDataAsset>(p.Name(), p.MetaData()));
+                        continue;
+                    }
+                    if (!options[i].Share.IsNone()) {
+                        continue;
+                    }
+                    if (options[i].Bank) {
+                        auto& index = indexParams.at(i);
+                        inputs.Add(TInputDataVertex<TArray<Metasound::FWaveAsset>>(p.Name(), p.MetaData()));
+                        inputs.Add(TInputDataVertex<int32>(index.Name(), index.MetaData(), 0));
+                    }
+                    else {
+                        inputs.Add(TInputDataVertex<Metasound::FWaveAsset>(p.Name(), p.MetaData()));
+                    }
+                }
             }
 
-            if (WithTransport()) {
+            if constexpr (WithTransport()) {
                 inputs.Add(TInputDataVertex<FTransport>(METASOUND_GET_PARAM_NAME_AND_METADATA(ParamTransport)));
             }
 
@@ -360,7 +762,7 @@ class FRNBOOperator : public Metasound::TExecutableOperator<FRNBOOperator<desc,
                 outputs.Add(TOutputDataVertex<Metasound::FAudioBuffer>(p.Name(), p.MetaData()));
             }
 
-            if (WithMIDIOut()) {
+            if constexpr (WithMIDIOut()) {
                 outputs.Add(TOutputDataVertex<HarmonixMetasound::FMidiStream>(METASOUND_GET_PARAM_NAME_AND_METADATA(ParamMIDIOut)));
             }
 
@@ -421,230 +823,285 @@ class FRNBOOperator : public Metasound::TExecutableOperator<FRNBOOperator<desc,
         const Metasound::FInputVertexInterface& InputInterface,
         Metasound::FBuildResults& OutResults)
         : FMidiVoiceGeneratorBase()
-        , CoreObject(RNBO::UniquePtr<RNBO::PatcherInterface>(FactoryFunction()()))
+        , CoreObject(Pool().Acquire(InSettings.GetSampleRate(), InSettings.GetNumFramesPerBlock()))
+        , RetireSlot(MakeUnique<FRetiredCoreObject>())
         , mNumFrames(InSettings.GetNumFramesPerBlock())
         , mSampleRate(InSettings.GetSampleRate())
+        , mSilence(Metasound::FAudioBufferReadRef::CreateNew(InSettings))
 
     {
-        CoreObject.prepareToProcess(InSettings.GetSampleRate(), InSettings.GetNumFramesPerBlock());
         // all params are handled in the audio thread, single producer seems to have better performance than NotThreadSafe
-        ParamInterface = CoreObject.createParameterInterface(RNBO::ParameterEventInterface::SingleProducer, this);
+        ParamInterface = CoreObject->createParameterInterface(RNBO::ParameterEventInterface::SingleProducer, this);
 
         // INPUTS
         for (auto& it : InportTrig()) {
-            mInportTriggerParams.emplace(it.first, InputCollection.GetOrCreateDefaultDataReadReference<Metasound::FTrigger>(it.second.Name(), InSettings));
+            mInportTriggerParams.push_back({ it.first, it.second.VertexName(), InputCollection.GetOrCreateDefaultDataReadReference<Metasound::FTrigger>(it.second.VertexName(), InSettings) });
         }
 
-        if (WithMIDIIn()) {
-            MIDIIn = { InputCollection.GetOrCreateDefaultDataReadReference<HarmonixMetasound::FMidiStream>(METASOUND_GET_PARAM_NAME(ParamMIDIIn), InSettings) };
+        if constexpr (WithMIDIIn()) {
+            MIDIIn = { InputCollection.GetOrCreateDefaultDataReadReference<HarmonixMetasound::FMidiStream>(MIDIInName(), InSettings) };
         }
 
+        mParamSlots.resize(ParamCount());
+        mInputFloatParams.reserve(InputFloatParams().size());
+        mInputIntParams.reserve(InputIntParams().size());
+        mInputBoolParams.reserve(InputBoolParams().size());
+        mOutputFloatParams.reserve(OutputFloatParams().size());
+        mOutputIntParams.reserve(OutputIntParams().size());
+        mOutputBoolParams.reserve(OutputBoolParams().size());
+
         for (auto& it : InputFloatParams()) {
-            mInputFloatParams.emplace(it.first, InputCollection.GetOrCreateDefaultDataReadReference<float>(it.second.Name(), InSettings));
+            auto& slots = mParamSlots[it.first];
+            slots.InputKind = EParamSlotKind::Float;
+            slots.Input = static_cast<uint32>(mInputFloatParams.size());
+            mInputFloatParams.push_back({ it.first, it.second.VertexName(), InputCollection.GetOrCreateDefaultDataReadReference<float>(it.second.VertexName(), InSettings), InitialValue(it.first) });
         }
 
         for (auto& it : InputIntParams()) {
-            mInputIntParams.emplace(it.first, InputCollection.GetOrCreateDefaultDataReadReference<int32>(it.second.Name(), InSettings));
+            auto& slots = mParamSlots[it.first];
+            slots.InputKind = EParamSlotKind::Int;
+            slots.Input = static_cast<uint32>(mInputIntParams.size());
+            mInputIntParams.push_back({ it.first, it.second.VertexName(), InputCollection.GetOrCreateDefaultDataReadReference<int32>(it.second.VertexName(), InSettings), InitialValue(it.first) });
         }
 
         for (auto& it : InputBoolParams()) {
-            mInputBoolParams.emplace(it.first, InputCollection.GetOrCreateDefaultDataReadReference<bool>(it.second.Name(), InSettings));
+            auto& slots = mParamSlots[it.first];
+            slots.InputKind = EParamSlotKind::Bool;
+            slots.Input = static_cast<uint32>(mInputBoolParams.size());
+            mInputBoolParams.push_back({ it.first, it.second.VertexName(), InputCollection.GetOrCreateDefaultDataReadReference<bool>(it.second.VertexName(), InSettings), InitialValue(it.first) });
+        }
+
+        // everything is live until the inputs are bound
+        mLiveFloatParams.reserve(mInputFloatParams.size());
+        mLiveIntParams.reserve(mInputIntParams.size());
+        mLiveBoolParams.reserve(mInputBoolParams.size());
+        for (uint32 i = 0; i < mInputFloatParams.size(); i++) {
+            mLiveFloatParams.push_back(i);
+        }
+        for (uint32 i = 0; i < mInputIntParams.size(); i++) {
+            mLiveIntParams.push_back(i);
+        }
+        for (uint32 i = 0; i < mInputBoolParams.size(); i++) {
+            mLiveBoolParams.push_back(i);
         }
 
         {
-            RNBO::DataRefIndex index = 0;
+            size_t index = 0;
+            auto& options = DataRefOptions();
+            auto& indexParams = DataRefIndexParams();
+            mDataRefParams.reserve(DataRefParams().size());
+            mDataRefBanks.reserve(DataRefParams().size());
+            mDataAssetParams.reserve(DataRefParams().size());
             for (auto& p : DataRefParams()) {
-                auto id = CoreObject.getExternalDataId(index++);
-                WaveAssetDataRef ref(CoreObject, id, p.Name(), InSettings, InputCollection);
+                const size_t i = index++;
+                auto& o = options[i];
+                auto id = CoreObject->getExternalDataId(o.Index);
+                if (o.Kind == EDataRefKind::Data) {
+                    mDataAssetParams.emplace_back(*CoreObject, id, p.VertexName(), o, InSettings, InputCollection);
+                    mDataAssetParams.back().Update();
+                    continue;
+                }
+                if (!o.Share.IsNone()) {
+                    const int32 frames = o.ShareFrames > 0 ? o.ShareFrames : static_cast<int32>(InSettings.GetSampleRate());
+                    mSharedBuffers.push_back(FSharedBuffers::Get().FindOrCreate(o.Share, frames, o.ShareChannels, InSettings.GetSampleRate()));
+                    BindWave(*CoreObject, id, mSharedBuffers.back());
+                    continue;
+                }
+                if (o.Bank) {
+                    WaveBankDataRef ref(*CoreObject, id, p.VertexName(), indexParams.at(i).VertexName(), o, InSettings, InputCollection);
+                    ref.Update(ELoadPriority::Normal);
+                    mDataRefBanks.push_back(std::move(ref));
+                    continue;
+                }
+                WaveAssetDataRef ref(*CoreObject, id, p.VertexName(), o, embedded.Find(id), InSettings, InputCollection);
                 // TODO could maybe even load the data in the main thread?
-                ref.Update();
+                ref.Update(ELoadPriority::Normal);
                 mDataRefParams.push_back(std::move(ref));
             }
         }
 
         for (auto& p : InputAudioParams()) {
-            mInputAudioParams.emplace_back(InputCollection.GetOrCreateDefaultDataReadReference<Metasound::FAudioBuffer>(p.Name(), InSettings));
-            mInputAudioBuffers.emplace_back(nullptr);
+            if (InputCollection.IsVertexBound(p.VertexName())) {
+                mInputAudioParams.emplace_back(InputCollection.GetOrCreateDefaultDataReadReference<Metasound::FAudioBuffer>(p.VertexName(), InSettings));
+            }
+            else {
+                mInputAudioParams.emplace_back(mSilence);
+            }
+        }
+        mParamSignals.reserve(Desc::ParamSignals.size());
+        for (size_t i = 0; i < Desc::ParamSignals.size(); i++) {
+            const RNBO::ParameterIndex index = Desc::ParamSignals[i].Index;
+            const size_t pin = Desc::InputSignals.size() + i;
+            const double value = InitialValue(index);
+            FParamSignalSlot& slot = mParamSignals.emplace_back(FParamSignalSlot{ index, pin, InputAudioChannel(pin), InputCollection.IsVertexBound(InputAudioParams()[pin].VertexName()), value, value });
+            slot.Fill.SetNumUninitialized(mNumFrames);
+            Audio::ArraySetToConstantInplace(slot.Fill, static_cast<float>(value));
+            if (static_cast<size_t>(index) < mParamSlots.size()) {
+                mParamSlots[index].Signal = static_cast<int32>(i);
+            }
+        }
+        mInputAudioBuffers.fill(mSilence->GetData());
+        for (size_t i = 0; i < mInputAudioParams.size(); i++) {
+            mInputAudioBuffers[InputAudioChannel(i)] = mInputAudioParams[i]->GetData();
+        }
+        for (auto& p : mParamSignals) {
+            if (!p.bConnected) {
+                mInputAudioBuffers[p.Channel] = p.Fill.GetData();
+            }
+        }
+
+        // the generated tables and the patch come from the same export, this only fails if they got out of sync
+        if (CoreObject->getNumInputChannels() != Desc::NumInputChannels || CoreObject->getNumOutputChannels() != Desc::OutputSignals.size()) {
+            UE_LOG(LogMetaSound, Error, TEXT("RNBO %s has %d input and %d output channels, its description lists %d and %d, the node outputs silence, export again"),
+                UTF8_TO_TCHAR(Desc::ClassName), static_cast<int32>(CoreObject->getNumInputChannels()), static_cast<int32>(CoreObject->getNumOutputChannels()),
+                static_cast<int32>(Desc::NumInputChannels), static_cast<int32>(Desc::OutputSignals.size()));
+            bChannelMismatch = true;
         }
 
         // OUTPUTS
 
         for (auto& it : OutportTrig()) {
-            mOutportTriggerParams.emplace(it.first, Metasound::FTriggerWriteRef::CreateNew(InSettings));
+            mOutportTriggerParams.push_back({ it.first, it.second.VertexName(), Metasound::FTriggerWriteRef::CreateNew(InSettings) });
         }
 
-        if (WithMIDIOut()) {
+        if constexpr (WithMIDIOut()) {
             MIDIOut = HarmonixMetasound::FMidiStreamWriteRef::CreateNew();
         }
 
         for (auto& it : OutputFloatParams()) {
-            mOutputFloatParams.emplace(it.first, Metasound::FFloatWriteRef::CreateNew(it.second.InitialValue()));
+            auto& slots = mParamSlots[it.first];
+            slots.OutputKind = EParamSlotKind::Float;
+            slots.Output = static_cast<uint32>(mOutputFloatParams.size());
+            mOutputFloatParams.push_back({ it.first, it.second.VertexName(), Metasound::FFloatWriteRef::CreateNew(it.second.InitialValue()) });
         }
 
         for (auto& it : OutputIntParams()) {
-            mOutputIntParams.emplace(it.first, Metasound::FInt32WriteRef::CreateNew(static_cast<int32>(it.second.InitialValue())));
+            auto& slots = mParamSlots[it.first];
+            slots.OutputKind = EParamSlotKind::Int;
+            slots.Output = static_cast<uint32>(mOutputIntParams.size());
+            mOutputIntParams.push_back({ it.first, it.second.VertexName(), Metasound::FInt32WriteRef::CreateNew(static_cast<int32>(it.second.InitialValue())) });
         }
 
         for (auto& it : OutputBoolParams()) {
-            mOutputBoolParams.emplace(it.first, Metasound::FBoolWriteRef::CreateNew(it.second.InitialValue() != 0.0f));
+            auto& slots = mParamSlots[it.first];
+            slots.OutputKind = EParamSlotKind::Bool;
+            slots.Output = static_cast<uint32>(mOutputBoolParams.size());
+            mOutputBoolParams.push_back({ it.first, it.second.VertexName(), Metasound::FBoolWriteRef::CreateNew(it.second.InitialValue() != 0.0f) });
         }
 
         for (auto& p : OutputAudioParams()) {
             mOutputAudioParams.emplace_back(Metasound::FAudioBufferWriteRef::CreateNew(InSettings));
-            mOutputAudioBuffers.emplace_back(nullptr);
+        }
+        for (size_t i = 0; i < mOutputAudioBuffers.size(); i++) {
+            mOutputAudioBuffers[i] = mOutputAudioParams[i]->GetData();
         }
 
-        if (WithTransport()) {
-            Transport = { InputCollection.GetOrCreateDefaultDataReadReference<FTransport>(METASOUND_GET_PARAM_NAME(ParamTransport), InSettings) };
+        if constexpr (WithTransport()) {
+            Transport = { InputCollection.GetOrCreateDefaultDataReadReference<FTransport>(TransportName(), InSettings) };
         }
     }
 
+    virtual ~FRNBOOperator()
+    {
+        // the interface holds on to us as its event handler, it has to go before the core object is reused
+        ParamInterface.reset();
+        // destroyed in the background, never reused
+        RetireSlot->CoreObject = MoveTemp(CoreObject);
+        RetireCoreObject(MoveTemp(RetireSlot));
+    }
+
+    // rebinding happens on live graph updates, everything here is bound through names made up front and doesn't allocate
     virtual void BindInputs(Metasound::FInputVertexInterfaceData& InOutVertexData) override
     {
-        {
-            auto lookup = InportTrig();
-            for (auto& [index, p] : mInportTriggerParams) {
-                auto it = lookup.find(index);
-                // should never fail
-                if (it != lookup.end()) {
-                    InOutVertexData.BindReadVertex(it->second.Name(), p);
-                }
-            }
+        for (auto& p : mInportTriggerParams) {
+            InOutVertexData.BindReadVertex(p.Name, p.Ref);
         }
 
-        if (MIDIIn.IsSet()) {
-            InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(ParamMIDIIn), MIDIIn.GetValue());
+        if constexpr (WithMIDIIn()) {
+            InOutVertexData.BindReadVertex(MIDIInName(), MIDIIn.GetValue());
         }
 
-        {
-            auto lookup = InputFloatParams();
-            for (auto& [index, p] : mInputFloatParams) {
-                auto it = lookup.find(index);
-                // should never fail
-                if (it != lookup.end()) {
-                    InOutVertexData.BindReadVertex(it->second.Name(), p);
-                }
-            }
-        }
-        {
-            auto lookup = InputIntParams();
-            for (auto& [index, p] : mInputIntParams) {
-                auto it = lookup.find(index);
-                // should never fail
-                if (it != lookup.end()) {
-                    InOutVertexData.BindReadVertex(it->second.Name(), p);
-                }
-            }
+        BindInputParams(InOutVertexData, mInputFloatParams, mLiveFloatParams);
+        BindInputParams(InOutVertexData, mInputIntParams, mLiveIntParams);
+        BindInputParams(InOutVertexData, mInputBoolParams, mLiveBoolParams);
+
+        for (auto& p : mDataRefParams) {
+            InOutVertexData.BindReadVertex(p.Name, p.WaveAsset);
         }
-        {
-            auto lookup = InputBoolParams();
-            for (auto& [index, p] : mInputBoolParams) {
-                auto it = lookup.find(index);
-                // should never fail
-                if (it != lookup.end()) {
-                    InOutVertexData.BindReadVertex(it->second.Name(), p);
-                }
-            }
+        for (auto& p : mDataRefBanks) {
+            InOutVertexData.BindReadVertex(p.Name, p.Waves);
+            InOutVertexData.BindReadVertex(p.IndexName, p.BankIndex);
         }
-        {
-            auto lookup = DataRefParams();
-            for (size_t i = 0; i < mDataRefParams.size(); i++) {
-                auto& p = lookup[i];
-                InOutVertexData.BindReadVertex(p.Name(), mDataRefParams[i].WaveAsset);
-            }
+        for (auto& p : mDataAssetParams) {
+            InOutVertexData.BindReadVertex(p.Name, p.Data);
         }
-        if (Transport.IsSet()) {
-            InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(ParamTransport), Transport.GetValue());
+        if constexpr (WithTransport()) {
+            InOutVertexData.BindReadVertex(TransportName(), Transport.GetValue());
         }
         {
-            auto lookup = InputAudioParams();
+            const auto& lookup = InputAudioParams();
+            for (auto& p : mParamSignals) {
+                p.bConnected = !IsConstantInput(InOutVertexData, lookup[p.Pin].VertexName());
+            }
             for (size_t i = 0; i < mInputAudioParams.size(); i++) {
-                auto& p = lookup[i];
-                InOutVertexData.BindReadVertex(p.Name(), mInputAudioParams[i]);
+                InOutVertexData.BindReadVertex(lookup[i].VertexName(), mInputAudioParams[i]);
+                mInputAudioBuffers[InputAudioChannel(i)] = mInputAudioParams[i]->GetData();
+            }
+            for (auto& p : mParamSignals) {
+                if (!p.bConnected) {
+                    mInputAudioBuffers[p.Channel] = p.Fill.GetData();
+                }
             }
         }
+        // constant pins are sent once, on the next block
+        bSendAllParams = true;
     }
 
     virtual void BindOutputs(Metasound::FOutputVertexInterfaceData& InOutVertexData) override
     {
-        {
-            auto lookup = OutportTrig();
-            for (auto& [index, p] : mOutportTriggerParams) {
-                auto it = lookup.find(index);
-                // should never fail
-                if (it != lookup.end()) {
-                    InOutVertexData.BindReadVertex(it->second.Name(), p);
-                }
-            }
+        for (auto& p : mOutportTriggerParams) {
+            InOutVertexData.BindReadVertex(p.Name, p.Ref);
         }
 
-        if (MIDIOut.IsSet()) {
-            InOutVertexData.BindReadVertex(METASOUND_GET_PARAM_NAME(ParamMIDIOut), MIDIOut.GetValue());
+        if constexpr (WithMIDIOut()) {
+            InOutVertexData.BindReadVertex(MIDIOutName(), MIDIOut.GetValue());
         }
 
-        {
-            auto lookup = OutputFloatParams();
-            for (auto& [index, p] : mOutputFloatParams) {
-                auto it = lookup.find(index);
-                // should never fail
-                if (it != lookup.end()) {
-                    InOutVertexData.BindReadVertex(it->second.Name(), p);
-                }
-            }
+        for (auto& slot : mOutputFloatParams) {
+            InOutVertexData.BindReadVertex(slot.Name, slot.Ref);
         }
-        {
-            auto lookup = OutputIntParams();
-            for (auto& [index, p] : mOutputIntParams) {
-                auto it = lookup.find(index);
-                // should never fail
-                if (it != lookup.end()) {
-                    InOutVertexData.BindReadVertex(it->second.Name(), p);
-                }
-            }
+        for (auto& slot : mOutputIntParams) {
+            InOutVertexData.BindReadVertex(slot.Name, slot.Ref);
         }
-        {
-            auto lookup = OutputBoolParams();
-            for (auto& [index, p] : mOutputBoolParams) {
-                auto it = lookup.find(index);
-                // should never fail
-                if (it != lookup.end()) {
-                    InOutVertexData.BindReadVertex(it->second.Name(), p);
-                }
-            }
+        for (auto& slot : mOutputBoolParams) {
+            InOutVertexData.BindReadVertex(slot.Name, slot.Ref);
         }
 
         {
-            auto lookup = OutputAudioParams();
+            const auto& lookup = OutputAudioParams();
             for (size_t i = 0; i < mOutputAudioParams.size(); i++) {
-                auto& p = lookup[i];
-                InOutVertexData.BindReadVertex(p.Name(), mOutputAudioParams[i]);
+                InOutVertexData.BindReadVertex(lookup[i].VertexName(), mOutputAudioParams[i]);
+                mOutputAudioBuffers[i] = mOutputAudioParams[i]->GetData();
             }
         }
     }
 
     void Execute()
     {
-        Converter = { CoreObject.getSampleRate(), CoreObject.getCurrentTime() };
+        Converter = { CoreObject->getSampleRate(), CoreObject->getCurrentTime() };
 
-        if (MIDIOut.IsSet()) {
+        if constexpr (WithMIDIOut()) {
             MIDIOut.GetValue()->PrepareBlock();
         }
 
         // update outport triggers
-        for (auto it : mOutportTriggerParams) {
-            it.second->AdvanceBlock();
-        }
-
-        // setup audio buffers
-        for (size_t i = 0; i < mInputAudioBuffers.size(); i++) {
-            mInputAudioBuffers[i] = mInputAudioParams[i]->GetData();
-        }
-
-        for (size_t i = 0; i < mOutputAudioBuffers.size(); i++) {
-            mOutputAudioBuffers[i] = mOutputAudioParams[i]->GetData();
+        if constexpr (WithOutportTrig()) {
+            for (auto& p : mOutportTriggerParams) {
+                p.Ref->AdvanceBlock();
+            }
         }
 
-        if (MIDIIn.IsSet()) {
+        if constexpr (WithMIDIIn()) {
             auto& midiin = MIDIIn.GetValue();
             for (const HarmonixMetasound::FMidiStreamEvent& Event : midiin->GetEventsInBlock()) {
                 auto& msg = Event.MidiMessage;
@@ -695,7 +1152,7 @@ class FRNBOOperator : public Metasound::TExecutableOperator<FRNBOOperator<desc,
             }
         }
 
-        if (Transport.IsSet()) {
+        if constexpr (WithTransport()) {
             auto& transport = Transport.GetValue();
             double btime = std::max(0.0, transport->GetBeatTime().GetSeconds()); // not actually seconds
             if (LastTransportBeatTime != btime)
@@ -735,48 +1192,174 @@ class FRNBOOperator : public Metasound::TExecutableOperator<FRNBOOperator<desc,
             }
         }
 
-        for (auto& [index, p] : mInputFloatParams) {
-            double v = static_cast<double>(*p);
-            if (v != ParamInterface->getParameterValue(index)) {
-                ParamInterface->setParameterValue(index, v);
+        if constexpr (WithParams(true)) {
+            if (bSendAllParams) {
+                bSendAllParams = false;
+                for (auto& slot : mInputFloatParams) {
+                    SendParam(slot);
+                }
+                for (auto& slot : mInputIntParams) {
+                    SendParam(slot);
+                }
+                for (auto& slot : mInputBoolParams) {
+                    SendParam(slot);
+                }
             }
-        }
-        for (auto& [index, p] : mInputIntParams) {
-            double v = static_cast<double>(*p);
-            if (v != ParamInterface->getParameterValue(index)) {
-                ParamInterface->setParameterValue(index, v);
+            else {
+                for (uint32 i : mLiveFloatParams) {
+                    SendParam(mInputFloatParams[i]);
+                }
+                for (uint32 i : mLiveIntParams) {
+                    SendParam(mInputIntParams[i]);
+                }
+                for (uint32 i : mLiveBoolParams) {
+                    SendParam(mInputBoolParams[i]);
+                }
             }
         }
-        for (auto& [index, p] : mInputBoolParams) {
-            double v = *p ? 1.0 : 0.0;
-            if (v != ParamInterface->getParameterValue(index)) {
-                ParamInterface->setParameterValue(index, v);
+        if constexpr (WithInportTrig()) {
+            for (auto& p : mInportTriggerParams) {
+                for (int32 i = 0; i < p.Ref->NumTriggeredInBlock(); i++) {
+                    auto frame = (*p.Ref)[i];
+                    ParamInterface->sendMessage(p.Tag, 0, Converter.convertSampleOffsetToMilliseconds(static_cast<RNBO::SampleOffset>(frame)));
+                }
             }
         }
-        for (auto& [tag, p] : mInportTriggerParams) {
-            for (int32 i = 0; i < p->NumTriggeredInBlock(); i++) {
-                auto frame = (*p)[i];
-                ParamInterface->sendMessage(tag, 0, Converter.convertSampleOffsetToMilliseconds(static_cast<RNBO::SampleOffset>(frame)));
+        if constexpr (WithDataRefs()) {
+            for (auto& p : mDataRefParams) {
+                p.Update();
+            }
+            for (auto& p : mDataRefBanks) {
+                p.Update();
+            }
+            for (auto& p : mDataAssetParams) {
+                p.Update();
             }
         }
-        for (auto& p : mDataRefParams) {
-            p.Update();
+
+        if constexpr (WithParamSignals()) {
+            for (auto& p : mParamSignals) {
+                if (!p.bConnected && p.Value != p.FilledValue) {
+                    p.FilledValue = p.Value;
+                    Audio::ArraySetToConstantInplace(p.Fill, static_cast<float>(p.Value));
+                }
+            }
         }
 
-        CoreObject.process(static_cast<const float* const*>(mInputAudioBuffers.data()), mInputAudioBuffers.size(), mOutputAudioBuffers.data(), mOutputAudioBuffers.size(), mNumFrames);
+        if (bChannelMismatch) {
+            return;
+        }
+        CoreObject->process(static_cast<const float* const*>(mInputAudioBuffers.data()), mInputAudioBuffers.size(), mOutputAudioBuffers.data(), mOutputAudioBuffers.size(), mNumFrames);
     }
 
-    // does this ever get called?
+    // called when a source is reused, puts the patch back in its initial state without making a new one
+    // datarefs stay bound, the pins are sent again on the next block
     void Reset(const Metasound::IOperator::FResetParams& InParams)
     {
-        for (auto it : mOutportTriggerParams) {
-            it.second->Reset();
+        for (auto& p : mOutportTriggerParams) {
+            p.Ref->Reset();
         }
-        if (MIDIOut.IsSet()) {
+        if constexpr (WithMIDIOut()) {
             auto m = MIDIOut.GetValue();
             m->PrepareBlock();
             m->ResetClock();
         }
+        for (auto& p : mOutputAudioParams) {
+            p->Zero();
+        }
+
+        // the forced prepare reruns the patch's DSP setup which may allocate
+        // RNBO keeps signal memory whose size is unchanged, but objects like delays may still reallocate theirs
+        // Reset only runs when a source is reused, so that is accepted rather than making a new patch
+        ResetCoreObject(*CoreObject, mSampleRate, mNumFrames, [this](RNBO::ParameterIndex index, const RNBO::ParameterInfo& info) {
+            ParamInterface->setParameterValue(index, info.initialValue);
+            if (static_cast<size_t>(index) >= mParamSlots.size()) {
+                return;
+            }
+            SignalValue(index, info.initialValue);
+            const FParamSlots& slots = mParamSlots[index];
+            switch (slots.InputKind) {
+                case EParamSlotKind::Float:
+                    mInputFloatParams[slots.Input].LastValue = info.initialValue;
+                    break;
+                case EParamSlotKind::Int:
+                    mInputIntParams[slots.Input].LastValue = info.initialValue;
+                    break;
+                case EParamSlotKind::Bool:
+                    mInputBoolParams[slots.Input].LastValue = info.initialValue;
+                    break;
+                default:
+                    break;
+            }
+            // output pins show the initial values until the patch reports new ones
+            switch (slots.OutputKind) {
+                case EParamSlotKind::Float:
+                    *mOutputFloatParams[slots.Output].Ref = static_cast<float>(info.initialValue);
+                    break;
+                case EParamSlotKind::Int:
+                    *mOutputIntParams[slots.Output].Ref = static_cast<int32>(info.initialValue);
+                    break;
+                case EParamSlotKind::Bool:
+                    *mOutputBoolParams[slots.Output].Ref = info.initialValue != 0.0;
+                    break;
+                default:
+                    break;
+            }
+        });
+        bSendAllParams = true;
+
+        LastTransportBeatTime = -1.0;
+        LastTransportBPM = 0.0f;
+        LastTransportRun = false;
+        LastTransportNum = 0;
+        LastTransportDen = 0;
+    }
+
+    // live is capacity reserved up front, refilling it doesn't allocate
+    template <typename SlotType>
+    static void BindInputParams(Metasound::FInputVertexInterfaceData& InOutVertexData, std::vector<SlotType>& slots, std::vector<uint32>& live)
+    {
+        live.clear();
+        for (uint32 i = 0; i < slots.size(); i++) {
+            auto& slot = slots[i];
+            if (!IsConstantInput(InOutVertexData, slot.Name)) {
+                live.push_back(i);
+            }
+            InOutVertexData.BindReadVertex(slot.Name, slot.Ref);
+        }
+    }
+
+    // sends the pin's value if it differs from the value last sent, or last set by the patch itself
+    template <typename SlotType>
+    void SendParam(SlotType& slot)
+    {
+        double v = static_cast<double>(*slot.Ref);
+        if (v != slot.LastValue) {
+            slot.LastValue = v;
+            ParamInterface->setParameterValue(slot.Index, v);
+            SignalValue(slot.Index, v);
+        }
+    }
+
+    // keeps the fill of an unconnected param~ pin following the parameter
+    void SignalValue(RNBO::ParameterIndex index, double value)
+    {
+        if constexpr (WithParamSignals()) {
+            const int32 signal = mParamSlots[index].Signal;
+            if (signal != INDEX_NONE) {
+                mParamSignals[signal].Value = value;
+            }
+        }
+    }
+
+    // the patch changed one of our inputs, the pin's value is sent again on the next block, even if the pin is constant
+    template <typename SlotType>
+    void InputChanged(SlotType& slot, double value)
+    {
+        slot.LastValue = value;
+        if (value != static_cast<double>(*slot.Ref)) {
+            bSendAllParams = true;
+        }
     }
 
     virtual void eventsAvailable()
@@ -786,26 +1369,39 @@ class FRNBOOperator : public Metasound::TExecutableOperator<FRNBOOperator<desc,
 
     virtual void handleParameterEvent(const RNBO::ParameterEvent& event) override
     {
-        {
-            auto it = mOutputBoolParams.find(event.getIndex());
-            if (it != mOutputBoolParams.end()) {
-                (*it->second) = static_cast<bool>(event.getValue() != 0.0f);
-                return;
-            }
+        const auto index = event.getIndex();
+        if (index >= mParamSlots.size()) {
+            return;
         }
-        {
-            auto it = mOutputFloatParams.find(event.getIndex());
-            if (it != mOutputFloatParams.end()) {
-                (*it->second) = static_cast<float>(event.getValue());
-                return;
-            }
+        const FParamSlots& slots = mParamSlots[index];
+        SignalValue(index, event.getValue());
+
+        switch (slots.InputKind) {
+            case EParamSlotKind::Float:
+                InputChanged(mInputFloatParams[slots.Input], event.getValue());
+                break;
+            case EParamSlotKind::Int:
+                InputChanged(mInputIntParams[slots.Input], event.getValue());
+                break;
+            case EParamSlotKind::Bool:
+                InputChanged(mInputBoolParams[slots.Input], event.getValue());
+                break;
+            default:
+                break;
         }
-        {
-            auto it = mOutputIntParams.find(event.getIndex());
-            if (it != mOutputIntParams.end()) {
-                (*it->second) = static_cast<int32>(event.getValue());
-                return;
-            }
+
+        switch (slots.OutputKind) {
+            case EParamSlotKind::Bool:
+                (*mOutputBoolParams[slots.Output].Ref) = static_cast<bool>(event.getValue() != 0.0f);
+                break;
+            case EParamSlotKind::Float:
+                (*mOutputFloatParams[slots.Output].Ref) = static_cast<float>(event.getValue());
+                break;
+            case EParamSlotKind::Int:
+                (*mOutputIntParams[slots.Output].Ref) = static_cast<int32>(event.getValue());
+                break;
+            default:
+                break;
         }
     }
 
@@ -814,10 +1410,13 @@ class FRNBOOperator : public Metasound::TExecutableOperator<FRNBOOperator<desc,
         switch (event.getType()) {
             case RNBO::MessageEvent::Type::Bang:
             {
-                auto it = mOutportTriggerParams.find(event.getTag());
-                if (it != mOutportTriggerParams.end()) {
-                    RNBO::SampleOffset frame = Converter.convertMillisecondsToSampleOffset(event.getTime());
-                    it->second->TriggerFrame(static_cast<int32>(frame));
+                // only a few outports, a scan beats hashing
+                for (auto& p : mOutportTriggerParams) {
+                    if (p.Tag == event.getTag()) {
+                        RNBO::SampleOffset frame = Converter.convertMillisecondsToSampleOffset(event.getTime());
+                        p.Ref->TriggerFrame(static_cast<int32>(frame));
+                        break;
+                    }
                 }
             } break;
             default:
@@ -828,31 +1427,30 @@ class FRNBOOperator : public Metasound::TExecutableOperator<FRNBOOperator<desc,
 
     virtual void handleMidiEvent(const RNBO::MidiEvent& event) override
     {
-        if (!MIDIOut.IsSet()) {
-            return;
+        if constexpr (WithMIDIOut()) {
+            RNBO::SampleOffset frame = Converter.convertMillisecondsToSampleOffset(event.getTime());
+
+            auto data = event.getData();
+            uint8 status = 0, data1 = 0, data2 = 0;
+            switch (event.getLength()) {
+                case 3:
+                    data2 = data[2];
+                    //fall thru
+                case 2:
+                    data1 = data[1];
+                    //fall thru
+                case 1:
+                    status = data[0];
+                    break;
+                default:
+                    break;
+            };
+
+            HarmonixMetasound::FMidiStreamEvent packet(this, FMidiMsg(status, data1, data2));
+            packet.BlockSampleFrameIndex = frame;
+            packet.TrackIndex = 1; // as per rec from Harmonix
+            MIDIOut.GetValue()->AddMidiEvent(packet);
         }
-        RNBO::SampleOffset frame = Converter.convertMillisecondsToSampleOffset(event.getTime());
-
-        auto data = event.getData();
-        uint8 status = 0, data1 = 0, data2 = 0;
-        switch (event.getLength()) {
-            case 3:
-                data2 = data[2];
-                //fall thru
-            case 2:
-                data1 = data[1];
-                //fall thru
-            case 1:
-                status = data[0];
-                break;
-            default:
-                break;
-        };
-
-        HarmonixMetasound::FMidiStreamEvent packet(this, FMidiMsg(status, data1, data2));
-        packet.BlockSampleFrameIndex = frame;
-        packet.TrackIndex = 1; // as per rec from Harmonix
-        MIDIOut.GetValue()->AddMidiEvent(packet);
     }
 };
 } // namespace RNBOMetasound
@@ -0,0 +1,41 @@
+#include "RNBOSharedBuffers.h"
+
+#include "MetasoundLog.h"
+
+namespace RNBOMetasound {
+
+FSharedBuffers& FSharedBuffers::Get()
+{
+    static FSharedBuffers Shared;
+    return Shared;
+}
+
+FDecodedWavePtr FSharedBuffers::FindOrCreate(FName Name, int32 NumFrames, int32 NumChannels, double SampleRate)
+{
+    FScopeLock Guard(&Mutex);
+    FDecodedWaveWeakPtr& Entry = Buffers.FindOrAdd(Name);
+    if (FDecodedWavePtr Existing = Entry.Pin()) {
+        // the first declaration wins, the others still share its memory but play it back at its rate
+        if (Existing->NumChannels != NumChannels || Existing->Num() != NumFrames * NumChannels || Existing->SampleRate != SampleRate) {
+            UE_LOG(LogMetaSound, Warning, TEXT("RNBO shared buffer %s is declared with a different size or sample rate (%d frames, %d channels, %.0f Hz), using the first one (%d frames, %d channels, %.0f Hz)"),
+                *Name.ToString(), NumFrames, NumChannels, SampleRate, Existing->Num() / FMath::Max(1, Existing->NumChannels), Existing->NumChannels, Existing->SampleRate);
+        }
+        return Existing;
+    }
+
+    FDecodedWavePtr Wave = MakeDecodedWave();
+    Wave->NumChannels = NumChannels;
+    Wave->SampleRate = SampleRate;
+    Wave->Samples.SetNumZeroed(NumFrames * NumChannels);
+    Entry = Wave;
+
+    // drop the names nobody uses anymore
+    for (auto It = Buffers.CreateIterator(); It; ++It) {
+        if (!It->Value.IsValid()) {
+            It.RemoveCurrent();
+        }
+    }
+    return Wave;
+}
+
+} // namespace RNBOMetasound
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RNBOWaveCache.h"
+
+namespace RNBOMetasound {
+
+// process wide buffers shared by name, from buffer~ @meta share:'name'
+// every dataref declaring the same name is bound to the same memory, so what one patch writes the others read
+// a buffer lives as long as some node holds it
+class FSharedBuffers
+{
+  public:
+    static FSharedBuffers& Get();
+
+    // the first declaration of a name sets its size and sample rate, later ones that differ get the existing buffer and a warning
+    FDecodedWavePtr FindOrCreate(FName Name, int32 NumFrames, int32 NumChannels, double SampleRate);
+
+  private:
+    FCriticalSection Mutex;
+    TMap<FName, FDecodedWaveWeakPtr> Buffers;
+};
+
+} // namespace RNBOMetasound
@@ -0,0 +1,704 @@
+#include "RNBOWaveCache.h"
+#include "RNBOBakedWave.h"
+#include "RNBOWaveLoader.h"
+
+#include "MetasoundLog.h"
+#include "Audio.h"
+#include "AudioDecompress.h"
+#include "Interfaces/IAudioFormat.h"
+#include "DSP/FloatArrayMath.h"
+#include "DSP/BufferVectorOperations.h"
+#include "AudioResampler.h"
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
+#include "Tasks/Task.h"
+#include "HAL/Event.h"
+#include <atomic>
+
+namespace RNBOMetasound {
+
+namespace {
+std::atomic<FDecodedWave*> RetiredWaves = nullptr;
+std::atomic<int64> RetiredBytes = 0;
+// bytes of cached waves not yet retired, kept up to date by FWaveCache::Insert and FRetireWave
+std::atomic<int64> CachedBytes = 0;
+std::atomic<bool> ReclaimScheduled = false;
+// set when a wave is retired or unbound, the reclaim task only runs after that
+std::atomic<bool> ReleasedSinceReclaim = false;
+FTSTicker::FDelegateHandle ReclaimTickerHandle;
+
+int32 BufferBudgetMBCVar = 0;
+FAutoConsoleVariableRef CVarRNBOBufferBudgetMB(
+    TEXT("au.RNBO.BufferBudgetMB"),
+    BufferBudgetMBCVar,
+    TEXT("Memory budget in MB for decoded RNBO buffers, unused buffers are kept within it and evicted least recently used first.\n")
+        TEXT("0: no budget, buffers are freed as soon as no node uses them (default)"),
+    ECVF_Default);
+
+int64 BudgetBytes()
+{
+    return static_cast<int64>(FMath::Max(0, BufferBudgetMBCVar)) * 1024 * 1024;
+}
+
+float ParallelDecodeSecondsCVar = 30.0f;
+FAutoConsoleVariableRef CVarRNBOParallelDecodeSeconds(
+    TEXT("au.RNBO.ParallelDecodeSeconds"),
+    ParallelDecodeSecondsCVar,
+    TEXT("RNBO wave assets at least this long are decoded in segments concurrently, if their format can seek to an exact frame.\n")
+        TEXT("0: never decode in segments. Default 30 seconds"),
+    ECVF_Default);
+
+FAutoConsoleCommand CmdRNBOBufferStats(
+    TEXT("au.RNBO.BufferStats"),
+    TEXT("Log RNBO decoded buffer memory stats."),
+    FConsoleCommandDelegate::CreateLambda([]() {
+        auto Stats = FWaveCache::Get().GetStats();
+        UE_LOG(LogMetaSound, Display, TEXT("RNBO buffers: %d cached, %lld bytes resident, %lld bytes retained while unused, budget %lld bytes, %lld bytes waiting for deferred release"),
+            Stats.Entries, Stats.ResidentBytes, Stats.RetainedBytes, Stats.BudgetBytes, GetDeferredReleaseBytes());
+    }));
+
+// used as the deleter of every decoded wave, no allocator calls, the wave is its own list node
+struct FRetireWave
+{
+    void operator()(FDecodedWave* Wave) const
+    {
+        if (Wave->bCached) {
+            CachedBytes -= static_cast<int64>(Wave->SizeInBytes());
+        }
+        RetiredBytes += static_cast<int64>(Wave->SizeInBytes());
+        FDecodedWave* Head = RetiredWaves.load(std::memory_order_relaxed);
+        do {
+            Wave->NextRetired = Head;
+        } while (!RetiredWaves.compare_exchange_weak(Head, Wave, std::memory_order_release, std::memory_order_relaxed));
+        ReleasedSinceReclaim.store(true, std::memory_order_relaxed);
+    }
+};
+
+void ReclaimRetired()
+{
+    // deleting a wave drops its weak reference to itself, which frees the reference controller too
+    FDecodedWave* Wave = RetiredWaves.exchange(nullptr, std::memory_order_acquire);
+    FDecodedWave* StillBound = nullptr;
+    while (Wave != nullptr) {
+        FDecodedWave* Next = Wave->NextRetired;
+        if (Wave->IsBound()) {
+            // a core object still has it, kept for a later run, its last ReleaseBind schedules one
+            Wave->NextRetired = StillBound;
+            StillBound = Wave;
+        }
+        else {
+            RetiredBytes -= static_cast<int64>(Wave->SizeInBytes());
+            delete Wave;
+        }
+        Wave = Next;
+    }
+    while (StillBound != nullptr) {
+        FDecodedWave* Next = StillBound->NextRetired;
+        FDecodedWave* Head = RetiredWaves.load(std::memory_order_relaxed);
+        do {
+            StillBound->NextRetired = Head;
+        } while (!RetiredWaves.compare_exchange_weak(Head, StillBound, std::memory_order_release, std::memory_order_relaxed));
+        StillBound = Next;
+    }
+}
+
+// frames decoded per chunk, also how much of a streamed wave is decoded before it is handed out
+constexpr int32 DecodeChunkFrames = 16384;
+
+ICompressedAudioInfo* CreateDecoder(const FSoundWaveProxyPtr& WaveProxy, FSoundQualityInfo& OutQuality)
+{
+    FName Format = WaveProxy->GetRuntimeFormat();
+    IAudioInfoFactory* Factory = IAudioInfoFactoryRegistry::Get().Find(Format);
+    if (Factory == nullptr) {
+        UE_LOG(LogMetaSound, Error, TEXT("IAudioInfoFactoryRegistry::Get().Find(%s) failed"), *Format.ToString());
+        return nullptr;
+    }
+
+    TUniquePtr<ICompressedAudioInfo> Decompress(Factory->Create());
+    if (WaveProxy->IsStreaming()) {
+        if (!Decompress->StreamCompressedInfo(WaveProxy, &OutQuality)) {
+            UE_LOG(LogMetaSound, Error, TEXT("RNBO Failed to get compressed stream info"));
+            return nullptr;
+        }
+    }
+    else {
+        if (!Decompress->ReadCompressedInfo(WaveProxy->GetResourceData(), WaveProxy->GetResourceSize(), &OutQuality)) {
+            UE_LOG(LogMetaSound, Error, TEXT("RNBO Failed to get compressed info"));
+            return nullptr;
+        }
+    }
+    return Decompress.Release();
+}
+
+// uncompressed 16 bit data is converted straight from the resource data, no codec involved
+// returns nullptr if the wave isn't stored that way, ADPCM and streamed PCM go through the codec
+FDecodedWavePtr ConvertPCM(const FSoundWaveProxyPtr& WaveProxy)
+{
+    static const FName NAME_PCM(TEXT("PCM"));
+    if (WaveProxy->GetRuntimeFormat() != NAME_PCM || WaveProxy->IsStreaming()) {
+        return nullptr;
+    }
+
+    FWaveModInfo WaveInfo;
+    if (!WaveInfo.ReadWaveInfo(WaveProxy->GetResourceData(), WaveProxy->GetResourceSize())) {
+        return nullptr;
+    }
+    if (*WaveInfo.pFormatTag != 1 /* WAVE_FORMAT_LPCM */ || *WaveInfo.pBitsPerSample != 16) {
+        return nullptr;
+    }
+
+    FDecodedWavePtr Wave = MakeDecodedWave();
+    Wave->NumChannels = *WaveInfo.pChannels;
+    Wave->SampleRate = *WaveInfo.pSamplesPerSec;
+    const int32 NumSamples = static_cast<int32>(WaveInfo.SampleDataSize / sizeof(int16));
+    Wave->Samples.SetNumUninitialized(NumSamples);
+    Audio::ArrayPcm16ToFloat(TArrayView<const int16>(reinterpret_cast<const int16*>(WaveInfo.SampleDataStart), NumSamples), Wave->Samples);
+    return Wave;
+}
+
+// decode NumSamples from the decoder's current position into Dest, returns false if cancelled
+// a decoder that finishes early leaves silence
+bool DecodeInto(ICompressedAudioInfo& Decompress, float* Dest, int32 NumSamples, int32 ChunkSamples, TFunctionRef<bool()> IsCancelled)
+{
+    TArray<int16> Chunk;
+    Chunk.SetNumUninitialized(FMath::Min(ChunkSamples, NumSamples));
+    int32 Offset = 0;
+    while (Offset < NumSamples) {
+        if (IsCancelled()) {
+            return false;
+        }
+        const int32 Count = FMath::Min(ChunkSamples, NumSamples - Offset);
+        const bool bFinished = Decompress.ReadCompressedData(reinterpret_cast<uint8*>(Chunk.GetData()), false, static_cast<uint32>(Count) * sizeof(int16));
+        Audio::ArrayPcm16ToFloat(TArrayView<const int16>(Chunk.GetData(), Count), TArrayView<float>(Dest + Offset, Count));
+        Offset += Count;
+        if (bFinished) {
+            break;
+        }
+    }
+    FMemory::Memzero(Dest + Offset, sizeof(float) * static_cast<size_t>(NumSamples - Offset));
+    return true;
+}
+
+// segments still to be claimed and decoded, shared with the loader jobs helping out
+struct FSegmentedDecode
+{
+    std::atomic<int32> NextSegment = 1;
+    std::atomic<int32> Remaining = 0;
+    std::atomic<bool> bFailed = false;
+    FEventRef Done{ EEventMode::ManualReset };
+};
+
+// long waves are split in segments, each decoded by its own decoder seeked to the segment start, concurrently
+// only for formats whose SeekToFrame is exact, otherwise the segments wouldn't line up
+// the segments are claimed by the calling loader job and by helper jobs on the loader's pool, so au.RNBO.DecodeWorkers bounds them too
+// returns nullptr if the wave doesn't qualify, the caller then decodes it in one go
+FDecodedWavePtr DecodeSegmented(const FSoundWaveProxyPtr& WaveProxy, TFunctionRef<bool()> IsCancelled)
+{
+    static const FName NAME_OGG(TEXT("OGG"));
+    if (ParallelDecodeSecondsCVar <= 0.0f || WaveProxy->IsStreaming() || WaveProxy->GetRuntimeFormat() != NAME_OGG || WaveProxy->GetDuration() < ParallelDecodeSecondsCVar) {
+        return nullptr;
+    }
+
+    // never split finer than this, each segment pays for a decoder and a seek
+    constexpr int32 MinSegmentFrames = 8 * DecodeChunkFrames;
+
+    FSoundQualityInfo quality;
+    TUniquePtr<ICompressedAudioInfo> First(CreateDecoder(WaveProxy, quality));
+    if (!First.IsValid()) {
+        return nullptr;
+    }
+    const int32 NumChannels = FMath::Max(1, WaveProxy->GetNumChannels());
+    const int32 NumSamples = static_cast<int32>(quality.SampleDataSize / sizeof(int16));
+    const int32 NumFrames = NumSamples / NumChannels;
+    const int32 NumSegments = FMath::Min(FMath::Max(1, FPlatformMisc::NumberOfCoresIncludingHyperthreads() - 1), NumFrames / MinSegmentFrames);
+    if (NumSegments < 2) {
+        return nullptr;
+    }
+
+    FDecodedWavePtr Wave = MakeDecodedWave();
+    Wave->NumChannels = WaveProxy->GetNumChannels();
+    Wave->SampleRate = WaveProxy->GetSampleRate();
+    Wave->Samples.SetNumUninitialized(NumSamples);
+    float* Dest = Wave->Samples.GetData();
+
+    const int32 SegmentFrames = FMath::DivideAndRoundUp(NumFrames, NumSegments);
+    const int32 ChunkSamples = DecodeChunkFrames * NumChannels;
+    TSharedRef<FSegmentedDecode, ESPMode::ThreadSafe> State = MakeShared<FSegmentedDecode, ESPMode::ThreadSafe>();
+    State->Remaining = NumSegments - 1;
+
+    // Dest and IsCancelled are only touched while a segment is claimed, and this waits for every claimed segment
+    auto DecodeSegment = [State, WaveProxy, Dest, NumSamples, NumFrames, NumChannels, SegmentFrames, ChunkSamples, IsCancelled](int32 Segment, TUniquePtr<ICompressedAudioInfo> Decompress) {
+        const int32 StartFrame = Segment * SegmentFrames;
+        const int32 EndFrame = FMath::Min(NumFrames, StartFrame + SegmentFrames);
+        float* SegmentDest = Dest + static_cast<size_t>(StartFrame) * NumChannels;
+        // the samples past the last whole frame, if any, go with the last segment
+        const int32 SegmentSamples = EndFrame == NumFrames ? NumSamples - StartFrame * NumChannels : (EndFrame - StartFrame) * NumChannels;
+
+        if (!Decompress.IsValid()) {
+            FSoundQualityInfo SegmentQuality;
+            Decompress.Reset(CreateDecoder(WaveProxy, SegmentQuality));
+            if (!Decompress.IsValid()) {
+                State->bFailed = true;
+                return;
+            }
+            Decompress->SeekToFrame(static_cast<uint32>(StartFrame));
+        }
+        if (!DecodeInto(*Decompress, SegmentDest, SegmentSamples, ChunkSamples, [&]() { return State->bFailed.load() || IsCancelled(); })) {
+            State->bFailed = true;
+        }
+    };
+    auto ClaimSegments = [State, NumSegments, DecodeSegment]() {
+        for (int32 Segment = State->NextSegment++; Segment < NumSegments; Segment = State->NextSegment++) {
+            DecodeSegment(Segment, nullptr);
+            if (--State->Remaining == 0) {
+                State->Done->Trigger();
+            }
+        }
+    };
+
+    // helpers that only get to run once everything is claimed have nothing left to do
+    for (int32 Helper = 1; Helper < NumSegments; Helper++) {
+        // at the priority of the load they help with, an urgent load isn't queued behind constructing nodes
+        FWaveLoader::Get().Launch(FWaveLoader::CurrentPriority(), ClaimSegments);
+    }
+    DecodeSegment(0, MoveTemp(First));
+    ClaimSegments();
+    State->Done->Wait();
+
+    if (State->bFailed.load()) {
+        return nullptr;
+    }
+    return Wave;
+}
+
+// decode chunk by chunk straight into the final float block, no int16 copy of the whole file is ever held
+FDecodedWavePtr DecodeChunked(const FSoundWaveProxyPtr& WaveProxy, TFunctionRef<void(const FDecodedWavePtr&)> OnFirstChunk, TFunctionRef<bool()> IsCancelled)
+{
+    if (IsCancelled()) {
+        return nullptr;
+    }
+
+    // fast enough that there is no point in handing out the first chunk early
+    if (FDecodedWavePtr Wave = ConvertPCM(WaveProxy)) {
+        return Wave;
+    }
+
+    FSoundQualityInfo quality;
+    TUniquePtr<ICompressedAudioInfo> Decompress(CreateDecoder(WaveProxy, quality));
+    if (!Decompress.IsValid()) {
+        return nullptr;
+    }
+
+    FDecodedWavePtr Wave = MakeDecodedWave();
+    Wave->NumChannels = WaveProxy->GetNumChannels();
+    Wave->SampleRate = WaveProxy->GetSampleRate();
+
+    // allocate everything up front, the block may be handed out before decoding is done so it must never move
+    const int32 NumSamples = static_cast<int32>(quality.SampleDataSize / sizeof(int16));
+    Wave->Samples.SetNumUninitialized(NumSamples);
+    float* Dest = Wave->Samples.GetData();
+
+    const bool bStreaming = WaveProxy->IsStreaming();
+    const int32 ChunkSamples = FMath::Min(NumSamples, DecodeChunkFrames * FMath::Max(1, Wave->NumChannels));
+    TArray<int16> Chunk;
+    Chunk.SetNumUninitialized(ChunkSamples);
+
+    bool bFinished = false;
+    bool bHandedOut = false;
+    int32 Offset = 0;
+    while (Offset < NumSamples && !bFinished) {
+        if (IsCancelled()) {
+            return nullptr;
+        }
+        int32 Count = FMath::Min(ChunkSamples, NumSamples - Offset);
+        uint8* ChunkBytes = reinterpret_cast<uint8*>(Chunk.GetData());
+        const uint32 ChunkSize = static_cast<uint32>(Count) * sizeof(int16);
+        if (bStreaming) {
+            // a streamed decoder can come back with less than asked for while it waits for the next streamed chunk
+            int32 ValidBytes = 0;
+            bFinished = Decompress->StreamCompressedData(ChunkBytes, false, ChunkSize, ValidBytes);
+            Count = FMath::Clamp(ValidBytes / static_cast<int32>(sizeof(int16)), 0, Count);
+        }
+        else {
+            bFinished = Decompress->ReadCompressedData(ChunkBytes, false, ChunkSize);
+        }
+
+        // vectorized int16 -> float
+        Audio::ArrayPcm16ToFloat(TArrayView<const int16>(Chunk.GetData(), Count), TArrayView<float>(Dest + Offset, Count));
+        Offset += Count;
+
+        // the rest is filled in behind the reader, a reader playing from the start never catches up with the decoder
+        if (!bHandedOut && Offset > 0) {
+            bHandedOut = true;
+            OnFirstChunk(Wave);
+        }
+    }
+    // a decoder that finishes before SampleDataSize leaves silence
+    FMemory::Memzero(Dest + Offset, sizeof(float) * static_cast<size_t>(NumSamples - Offset));
+    return Wave;
+}
+} // namespace
+
+FDecodedWavePtr DecodeWave(const FSoundWaveProxyPtr& WaveProxy, TFunctionRef<bool()> IsCancelled)
+{
+    if (IsCancelled()) {
+        return nullptr;
+    }
+    if (FDecodedWavePtr Wave = DecodeSegmented(WaveProxy, IsCancelled)) {
+        return Wave;
+    }
+    return DecodeChunked(WaveProxy, [](const FDecodedWavePtr&) {}, IsCancelled);
+}
+
+FDecodedWavePtr StreamWave(const FSoundWaveProxyPtr& WaveProxy, TFunctionRef<void(const FDecodedWavePtr&)> OnFirstChunk, TFunctionRef<bool()> IsCancelled)
+{
+    return DecodeChunked(WaveProxy, OnFirstChunk, IsCancelled);
+}
+
+FDecodedWavePtr CopyWave(const FDecodedWave& Source)
+{
+    FDecodedWavePtr Wave = MakeDecodedWave();
+    Wave->NumChannels = Source.NumChannels;
+    Wave->SampleRate = Source.SampleRate;
+    Wave->Samples.Append(Source.GetData(), Source.Num());
+    Wave->Source = Source.Pin();
+    return Wave;
+}
+
+FDecodedWavePtr TransformWave(const FDecodedWave& Source, const FWaveTransform& Transform)
+{
+    const int32 SourceChannels = FMath::Max(1, Source.NumChannels);
+    const int32 SourceFrames = Source.Num() / SourceChannels;
+    const int32 Start = FMath::Clamp(Transform.StartFrame, 0, SourceFrames);
+    const int32 End = Transform.EndFrame > 0 ? FMath::Clamp(Transform.EndFrame, Start, SourceFrames) : SourceFrames;
+    const int32 Frames = End - Start;
+    const float* In = Source.GetData() + static_cast<size_t>(Start) * SourceChannels;
+
+    // the resampler wants an aligned buffer, so the slice and channel work goes into one
+    int32 NumChannels = SourceChannels;
+    Audio::FAlignedFloatBuffer Buffer;
+    if (Transform.Downmix && SourceChannels > 1) {
+        NumChannels = 1;
+        Buffer.SetNumUninitialized(Frames);
+        const float Gain = 1.0f / static_cast<float>(SourceChannels);
+        for (int32 Frame = 0; Frame < Frames; Frame++) {
+            float Sum = 0.0f;
+            for (int32 Channel = 0; Channel < SourceChannels; Channel++) {
+                Sum += In[Frame * SourceChannels + Channel];
+            }
+            Buffer[Frame] = Sum * Gain;
+        }
+    }
+    else if (Transform.Channel != INDEX_NONE) {
+        if (Transform.Channel >= SourceChannels) {
+            UE_LOG(LogMetaSound, Warning, TEXT("RNBO buffer channel %d out of range, the wave has %d channels"), Transform.Channel + 1, SourceChannels);
+        }
+        const int32 Selected = FMath::Clamp(Transform.Channel, 0, SourceChannels - 1);
+        NumChannels = 1;
+        Buffer.SetNumUninitialized(Frames);
+        for (int32 Frame = 0; Frame < Frames; Frame++) {
+            Buffer[Frame] = In[Frame * SourceChannels + Selected];
+        }
+    }
+    else {
+        Buffer.Append(In, Frames * SourceChannels);
+    }
+
+    double SampleRate = Source.SampleRate;
+    if (Transform.SampleRate > 0.0f && static_cast<double>(Transform.SampleRate) != SampleRate && Frames > 0) {
+        Audio::FResamplingParameters Params = { Audio::EResamplingMethod::BestSinc, NumChannels, static_cast<float>(SampleRate), Transform.SampleRate, Buffer };
+        Audio::FAlignedFloatBuffer Resampled;
+        Resampled.AddUninitialized(Audio::GetOutputBufferSize(Params));
+        Audio::FResamplerResults Results;
+        Results.OutBuffer = &Resampled;
+        if (Audio::Resample(Params, Results)) {
+            Resampled.SetNum(Results.OutputFramesGenerated * NumChannels);
+            Buffer = MoveTemp(Resampled);
+            SampleRate = Transform.SampleRate;
+        }
+        else {
+            UE_LOG(LogMetaSound, Warning, TEXT("RNBO failed to resample buffer from %f to %f, keeping the original rate"), SampleRate, Transform.SampleRate);
+        }
+    }
+
+    FDecodedWavePtr Wave = MakeDecodedWave();
+    Wave->NumChannels = NumChannels;
+    Wave->SampleRate = SampleRate;
+    Wave->Samples.Append(Buffer.GetData(), Buffer.Num());
+    return Wave;
+}
+
+FDecodedWavePtr MakeDecodedWave()
+{
+    FDecodedWavePtr Wave(new FDecodedWave(), FRetireWave());
+    Wave->Self = Wave;
+    return Wave;
+}
+
+void FDecodedWave::ReleaseBind()
+{
+    if (NumBinds.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // the wave may be retired already, or cached data may have become evictable
+        ReleasedSinceReclaim.store(true, std::memory_order_relaxed);
+    }
+}
+
+void StartWaveReclaim()
+{
+    ReclaimTickerHandle = FTSTicker::GetCoreTicker().AddTicker(TEXT("RNBOWaveReclaim"), 0.5f, [](float) {
+        // nothing can have become evictable or reclaimable unless something was released since the last run
+        if (!ReclaimScheduled.load() && ReleasedSinceReclaim.exchange(false, std::memory_order_relaxed)) {
+            ReclaimScheduled = true;
+            UE::Tasks::Launch(
+                UE_SOURCE_LOCATION,
+                []() {
+                    // data released since the last insert may now be evictable, whatever that frees is reclaimed right after
+                    FWaveCache::Get().Trim();
+                    ReclaimRetired();
+                    // cleared last so StopWaveReclaim can wait for the task, anything retired meanwhile is picked up by the next tick
+                    ReclaimScheduled = false;
+                },
+                UE::Tasks::ETaskPriority::BackgroundLow);
+        }
+        return true;
+    });
+}
+
+void StopWaveReclaim()
+{
+    FTSTicker::GetCoreTicker().RemoveTicker(ReclaimTickerHandle);
+    // a task scheduled by the last tick may still be running, it uses module code
+    while (ReclaimScheduled.load()) {
+        FPlatformProcess::Sleep(0.001f);
+    }
+    ReclaimRetired();
+}
+
+int64 GetDeferredReleaseBytes()
+{
+    return RetiredBytes.load();
+}
+
+FWaveCache& FWaveCache::Get()
+{
+    static FWaveCache Cache;
+    return Cache;
+}
+
+FDecodedWavePtr FWaveCache::Find(const FWaveCacheKey& Key)
+{
+    FScopeLock Guard(&Mutex);
+    if (FEntry* Entry = Entries.Find(Key)) {
+        FDecodedWavePtr Wave = Entry->Wave.Pin();
+        if (Wave.IsValid()) {
+            Entry->LastUse = ++UseClock;
+            if (BudgetBytes() > 0) {
+                Entry->Retained = Wave;
+            }
+        }
+        return Wave;
+    }
+    return nullptr;
+}
+
+FDecodedWavePtr FWaveCache::FindOrTransform(const FWaveCacheKey& Key)
+{
+    if (FDecodedWavePtr Wave = Find(Key)) {
+        return Wave;
+    }
+    if (Key.Transform.IsIdentity()) {
+        return nullptr;
+    }
+    FDecodedWavePtr Source = Find({ Key.Object, FWaveTransform() });
+    if (!Source.IsValid()) {
+        return nullptr;
+    }
+    FDecodedWavePtr Wave = TransformWave(*Source, Key.Transform);
+    return Wave.IsValid() ? Insert(Key, Wave) : nullptr;
+}
+
+FDecodedWavePtr FWaveCache::FindOrDecode(const FSoundWaveProxyPtr& WaveProxy, const FWaveTransform& Transform, TFunctionRef<bool()> IsCancelled)
+{
+    const FWaveCacheKey Key{ WaveProxy->GetFObjectKey(), Transform };
+    while (true) {
+        if (FDecodedWavePtr Wave = Find(Key)) {
+            return Wave;
+        }
+
+        // the loader only merges loads of the same key, the untransformed source of different transforms is merged here
+        TSharedPtr<FInFlight, ESPMode::ThreadSafe> Pending;
+        bool bOwner = false;
+        {
+            FScopeLock Guard(&Mutex);
+            if (auto* Existing = InFlight.Find(Key)) {
+                Pending = *Existing;
+            }
+            else {
+                Pending = MakeShared<FInFlight, ESPMode::ThreadSafe>();
+                InFlight.Add(Key, Pending);
+                bOwner = true;
+            }
+        }
+
+        if (bOwner) {
+            FDecodedWavePtr Wave = Decode(WaveProxy, Transform, IsCancelled);
+            Pending->Result = Wave.IsValid() ? Insert(Key, Wave) : nullptr;
+            Pending->bCancelled = !Wave.IsValid() && IsCancelled();
+            {
+                FScopeLock Guard(&Mutex);
+                InFlight.Remove(Key);
+            }
+            Pending->Done->Trigger();
+            return Pending->Result;
+        }
+
+        while (!Pending->Done->Wait(10)) {
+            if (IsCancelled()) {
+                return nullptr;
+            }
+        }
+        // a decode that failed fails for everyone, one that was cancelled is started again by whoever still wants it
+        if (Pending->Result.IsValid() || !Pending->bCancelled || IsCancelled()) {
+            return Pending->Result;
+        }
+    }
+}
+
+FDecodedWavePtr FWaveCache::Decode(const FSoundWaveProxyPtr& WaveProxy, const FWaveTransform& Transform, TFunctionRef<bool()> IsCancelled)
+{
+    // decode outside of the lock, loads of other assets shouldn't wait on this one
+    FDecodedWavePtr Wave;
+    if (Transform.IsIdentity()) {
+        Wave = MapBakedWave(WaveProxy);
+        if (!Wave.IsValid()) {
+            Wave = DecodeWave(WaveProxy, IsCancelled);
+        }
+    }
+    else {
+        FDecodedWavePtr Source = FindOrDecode(WaveProxy, FWaveTransform(), IsCancelled);
+        if (!Source.IsValid() || IsCancelled()) {
+            return nullptr;
+        }
+        Wave = TransformWave(*Source, Transform);
+    }
+    return Wave;
+}
+
+FDecodedWavePtr FWaveCache::FindOrStream(const FSoundWaveProxyPtr& WaveProxy, TFunctionRef<void(const FDecodedWavePtr&)> OnFirstChunk, TFunctionRef<bool()> IsCancelled, bool bShare)
+{
+    const FWaveCacheKey Key{ WaveProxy->GetFObjectKey(), FWaveTransform() };
+    if (FDecodedWavePtr Wave = Find(Key)) {
+        return bShare ? Wave : CopyWave(*Wave);
+    }
+
+    // baked data is complete right away, there is nothing to stream
+    if (FDecodedWavePtr Baked = MapBakedWave(WaveProxy)) {
+        Baked = Insert(Key, Baked);
+        return bShare ? Baked : CopyWave(*Baked);
+    }
+
+    // the partial block is written to while the caller reads it, so a private one is never handed to anybody else
+    FDecodedWavePtr Wave = StreamWave(WaveProxy, OnFirstChunk, IsCancelled);
+    if (!Wave.IsValid() || !bShare) {
+        return Wave;
+    }
+    // only publish to the cache once complete, other pins shouldn't pick up a partial block
+    return Insert(Key, Wave);
+}
+
+FDecodedWavePtr FWaveCache::Insert(const FWaveCacheKey& Key, const FDecodedWavePtr& Wave)
+{
+    FScopeLock Guard(&Mutex);
+    FEntry& Entry = Entries.FindOrAdd(Key);
+    Entry.LastUse = ++UseClock;
+    // someone else may have finished decoding the same asset while we were, share theirs
+    if (FDecodedWavePtr Existing = Entry.Wave.Pin()) {
+        return Existing;
+    }
+    Entry.Wave = Wave;
+    Wave->bCached = true;
+    CachedBytes += static_cast<int64>(Wave->SizeInBytes());
+    if (BudgetBytes() > 0) {
+        Entry.Retained = Wave;
+    }
+
+    // drop entries whose data has been released
+    for (auto It = Entries.CreateIterator(); It; ++It) {
+        if (!It->Value.Wave.IsValid()) {
+            It.RemoveCurrent();
+        }
+    }
+
+    Evict();
+    return Wave;
+}
+
+bool FWaveCache::IsOverBudget() const
+{
+    const int64 Budget = BudgetBytes();
+    return Budget > 0 && CachedBytes.load(std::memory_order_relaxed) > Budget;
+}
+
+void FWaveCache::Trim()
+{
+    FScopeLock Guard(&Mutex);
+    Evict();
+}
+
+FWaveCache::FStats FWaveCache::GetStats()
+{
+    FScopeLock Guard(&Mutex);
+    FStats Stats;
+    Stats.ResidentBytes = CachedBytes.load();
+    Stats.BudgetBytes = BudgetBytes();
+    for (auto& It : Entries) {
+        if (It.Value.Retained.IsValid() && It.Value.Retained.GetSharedReferenceCount() == 1) {
+            Stats.RetainedBytes += static_cast<int64>(It.Value.Retained->SizeInBytes());
+        }
+        if (It.Value.Wave.IsValid()) {
+            Stats.Entries++;
+        }
+    }
+    return Stats;
+}
+
+// expects Mutex to be locked
+void FWaveCache::Evict()
+{
+    const int64 Budget = BudgetBytes();
+    if (Budget <= 0) {
+        // the budget may have been turned off since the data was retained
+        for (auto& It : Entries) {
+            It.Value.Retained.Reset();
+        }
+        return;
+    }
+
+    if (CachedBytes.load() <= Budget) {
+        return;
+    }
+
+    // only data held by nothing but the cache can actually be freed, least recently used goes first
+    TArray<FEntry*> Unused;
+    for (auto& It : Entries) {
+        if (It.Value.Retained.IsValid() && It.Value.Retained.GetSharedReferenceCount() == 1) {
+            Unused.Add(&It.Value);
+        }
+    }
+    Unused.Sort([](const FEntry& A, const FEntry& B) { return A.LastUse < B.LastUse; });
+
+    for (FEntry* Entry : Unused) {
+        if (CachedBytes.load() <= Budget) {
+            break;
+        }
+        // the last reference, retiring the data takes it off CachedBytes and it is freed in the background
+        Entry->Retained.Reset();
+    }
+
+    const int64 Resident = CachedBytes.load();
+    if (Resident > Budget) {
+        UE_LOG(LogMetaSound, Verbose, TEXT("RNBO buffers in use (%lld bytes) exceed au.RNBO.BufferBudgetMB"), Resident);
+    }
+}
+
+} // namespace RNBOMetasound
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+#include "Async/MappedFileHandle.h"
+#include "Sound/SoundWave.h"
+#include "HAL/Event.h"
+#include <atomic>
+
+namespace RNBOMetasound {
+
+// interleaved float samples decoded from a wave asset, shared by every pin and operator that only reads it
+struct FDecodedWave
+{
+    TArray<float> Samples;
+    int32 NumChannels = 0;
+    double SampleRate = 0.0;
+
+    // set instead of Samples when the data is mapped from a baked file, read only
+    TUniquePtr<IMappedFileHandle> MappedFile;
+    TUniquePtr<IMappedFileRegion> MappedRegion;
+    const float* MappedSamples = nullptr;
+    int32 NumMappedSamples = 0;
+
+    bool IsMapped() const { return MappedSamples != nullptr; }
+    const float* GetData() const { return IsMapped() ? MappedSamples : Samples.GetData(); }
+    int32 Num() const { return IsMapped() ? NumMappedSamples : Samples.Num(); }
+    size_t SizeInBytes() const { return sizeof(float) * static_cast<size_t>(Num()); }
+
+    // core objects the data is bound to hold binds rather than shared pointers, so their release callbacks only need a raw pointer
+    // a retired wave isn't reclaimed while it is bound, whoever binds it keeps a shared pointer for others to find it by
+    // lock free, this is called on the audio thread
+    void AddBind() { NumBinds.fetch_add(1, std::memory_order_relaxed); }
+    void ReleaseBind();
+    bool IsBound() const { return NumBinds.load(std::memory_order_acquire) > 0; }
+
+    // link in the list of retired waves, see MakeDecodedWave
+    FDecodedWave* NextRetired = nullptr;
+    // set once the wave is published to FWaveCache, its size counts as resident until it is retired
+    bool bCached = false;
+    // for a copy, the wave it was copied from, kept alive so the next copy doesn't have to decode it again
+    TSharedPtr<FDecodedWave, ESPMode::ThreadSafe> Source;
+
+    // nullptr unless made with MakeDecodedWave
+    TSharedPtr<FDecodedWave, ESPMode::ThreadSafe> Pin() const { return Self.Pin(); }
+
+  private:
+    friend TSharedPtr<FDecodedWave, ESPMode::ThreadSafe> MakeDecodedWave();
+
+    TWeakPtr<FDecodedWave, ESPMode::ThreadSafe> Self;
+    std::atomic<int32> NumBinds = 0;
+};
+
+using FDecodedWavePtr = TSharedPtr<FDecodedWave, ESPMode::ThreadSafe>;
+using FDecodedWaveWeakPtr = TWeakPtr<FDecodedWave, ESPMode::ThreadSafe>;
+
+// applied once to the decoded data when it is loaded, in this order: slice, channel selection or downmix, resample
+// the default transform leaves the data as decoded
+struct FWaveTransform
+{
+    int32 StartFrame = 0;
+    // exclusive, 0 for the end of the wave
+    int32 EndFrame = 0;
+    // keep only this channel, INDEX_NONE keeps them all
+    int32 Channel = INDEX_NONE;
+    // mix all channels down to mono, takes precedence over Channel
+    bool Downmix = false;
+    // resample to this rate, 0 keeps the wave's rate
+    float SampleRate = 0.0f;
+
+    bool IsIdentity() const { return *this == FWaveTransform(); }
+
+    bool operator==(const FWaveTransform& Other) const
+    {
+        return StartFrame == Other.StartFrame && EndFrame == Other.EndFrame && Channel == Other.Channel && Downmix == Other.Downmix && SampleRate == Other.SampleRate;
+    }
+};
+
+inline uint32 GetTypeHash(const FWaveTransform& Transform)
+{
+    uint32 Hash = HashCombine(::GetTypeHash(Transform.StartFrame), ::GetTypeHash(Transform.EndFrame));
+    Hash = HashCombine(Hash, ::GetTypeHash(Transform.Channel));
+    Hash = HashCombine(Hash, ::GetTypeHash(static_cast<uint8>(Transform.Downmix)));
+    return HashCombine(Hash, ::GetTypeHash(Transform.SampleRate));
+}
+
+// the same wave with different transforms is cached separately
+struct FWaveCacheKey
+{
+    FObjectKey Object;
+    FWaveTransform Transform;
+
+    bool operator==(const FWaveCacheKey& Other) const { return Object == Other.Object && Transform == Other.Transform; }
+};
+
+inline uint32 GetTypeHash(const FWaveCacheKey& Key)
+{
+    return HashCombine(GetTypeHash(Key.Object), GetTypeHash(Key.Transform));
+}
+
+// the last reference to a wave is often dropped by a core object on the audio thread
+// so waves made here are never freed where that happens, they are retired and reclaimed by a background task
+// retiring only links the wave into an intrusive list, and the wave's weak reference to itself keeps the
+// shared pointer's reference controller alive until the wave is deleted, so neither is freed on the audio thread
+FDecodedWavePtr MakeDecodedWave();
+
+// retired waves are reclaimed from a core ticker, started and stopped with the module
+void StartWaveReclaim();
+void StopWaveReclaim();
+
+// bytes of sample memory retired but not yet reclaimed
+int64 GetDeferredReleaseBytes();
+
+// decode the whole wave into interleaved float samples, blocking, returns nullptr on failure
+// IsCancelled is checked between chunks, a cancelled decode stops there and returns nullptr
+FDecodedWavePtr DecodeWave(const FSoundWaveProxyPtr& WaveProxy, TFunctionRef<bool()> IsCancelled);
+
+// decode the wave chunk by chunk into a block allocated up front, blocking
+// OnFirstChunk is handed the block as soon as the first chunk is in, the rest is decoded into it afterwards
+// the part the decoder hasn't reached yet isn't initialized, only readonly pins that read behind the decoder bind it
+FDecodedWavePtr StreamWave(const FSoundWaveProxyPtr& WaveProxy, TFunctionRef<void(const FDecodedWavePtr&)> OnFirstChunk, TFunctionRef<bool()> IsCancelled);
+
+// returns a copy of Source that nobody else holds, for a patch that writes to its buffer
+// the copy holds on to Source, so it stays cached for as long as any copy of it is around
+FDecodedWavePtr CopyWave(const FDecodedWave& Source);
+
+// returns a new wave with Transform applied to Source, blocking, resampling uses the best quality sinc resampler
+FDecodedWavePtr TransformWave(const FDecodedWave& Source, const FWaveTransform& Transform);
+
+// process wide cache of decoded wave data keyed on the FObjectKey of the wave's proxy and the transform applied to it
+// with au.RNBO.BufferBudgetMB at 0 the cache only holds weak references, the data is freed once the last core object using it releases it
+// with a budget the cache also retains data nobody uses anymore, evicting the least recently used once everything cached goes over the budget
+class FWaveCache
+{
+  public:
+    struct FStats
+    {
+        int64 ResidentBytes = 0;
+        int64 RetainedBytes = 0;
+        int64 BudgetBytes = 0;
+        int32 Entries = 0;
+    };
+
+    static FWaveCache& Get();
+
+    // returns the decoded data if some other pin or operator currently holds it or the budget retains it
+    // a hit counts as a use, so it is retained and evicted last
+    // takes the cache's lock, never called on the audio thread
+    FDecodedWavePtr Find(const FWaveCacheKey& Key);
+
+    // returns the cached data, or transforms it from its cached untransformed source, blocking
+    // returns nullptr rather than decode anything, for nodes being constructed to bind prefetched data right away
+    FDecodedWavePtr FindOrTransform(const FWaveCacheKey& Key);
+
+    // returns the cached data, decoding and transforming it (blocking) if nobody holds it yet
+    // a transformed wave is made from the untransformed one, which is shared with the pins that use it as is
+    // concurrent calls for the same key wait on one decode, so transforms of the same wave decode their source once
+    FDecodedWavePtr FindOrDecode(const FSoundWaveProxyPtr& WaveProxy, const FWaveTransform& Transform, TFunctionRef<bool()> IsCancelled);
+
+    // like FindOrDecode but with StreamWave and no transform, OnFirstChunk is only called if the data wasn't cached
+    // without bShare the data returned is the caller's own, a copy of cached data or a decode that is never cached
+    FDecodedWavePtr FindOrStream(const FSoundWaveProxyPtr& WaveProxy, TFunctionRef<void(const FDecodedWavePtr&)> OnFirstChunk, TFunctionRef<bool()> IsCancelled, bool bShare);
+
+    // true if a budget is set and the cached data, used or not, is over it
+    // only an atomic load, cheap enough for the audio thread
+    bool IsOverBudget() const;
+
+    // evicts unused data if over the budget, called from the deferred release task as data is released
+    void Trim();
+
+    FStats GetStats();
+
+  private:
+    struct FEntry
+    {
+        FDecodedWaveWeakPtr Wave;
+        // keeps the data around for later users, dropped on eviction
+        FDecodedWavePtr Retained;
+        uint64 LastUse = 0;
+    };
+
+    // a decode that others with the same key wait on rather than decoding it again
+    struct FInFlight
+    {
+        FEventRef Done{ EEventMode::ManualReset };
+        FDecodedWavePtr Result;
+        bool bCancelled = false;
+    };
+
+    FDecodedWavePtr Decode(const FSoundWaveProxyPtr& WaveProxy, const FWaveTransform& Transform, TFunctionRef<bool()> IsCancelled);
+    FDecodedWavePtr Insert(const FWaveCacheKey& Key, const FDecodedWavePtr& Wave);
+    void Evict();
+
+    FCriticalSection Mutex;
+    TMap<FWaveCacheKey, FEntry> Entries;
+    TMap<FWaveCacheKey, TSharedPtr<FInFlight, ESPMode::ThreadSafe>> InFlight;
+    uint64 UseClock = 0;
+};
+
+} // namespace RNBOMetasound
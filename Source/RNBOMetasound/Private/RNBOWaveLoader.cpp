@@ -0,0 +1,402 @@
+#include "RNBOWaveLoader.h"
+
+#include "MetasoundLog.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Tasks/Task.h"
+
+namespace {
+int32 DecodeWorkersCVar = 0;
+FAutoConsoleVariableRef CVarRNBODecodeWorkers(
+    TEXT("au.RNBO.DecodeWorkers"),
+    DecodeWorkersCVar,
+    TEXT("Maximum number of RNBO wave assets decoded concurrently.\n")
+        TEXT("0: half the number of cores (default)"),
+    ECVF_Default);
+
+FAutoConsoleCommand CmdRNBODecodeStats(
+    TEXT("au.RNBO.DecodeStats"),
+    TEXT("Log the RNBO wave decode pool queue depth and wait times."),
+    FConsoleCommandDelegate::CreateLambda([]() {
+        auto Stats = RNBOMetasound::FWaveLoader::Get().GetStats();
+        UE_LOG(LogMetaSound, Display, TEXT("RNBO decode pool: queued %d, running %d, started %llu, average wait %.3fs, max wait %.3fs"),
+            Stats.QueueDepth, Stats.Running, Stats.Started, Stats.AverageWaitSeconds, Stats.MaxWaitSeconds);
+    }));
+
+// set while a worker runs a job
+thread_local RNBOMetasound::ELoadPriority WorkerPriority = RNBOMetasound::ELoadPriority::Normal;
+
+int32 MaxWorkers()
+{
+    if (DecodeWorkersCVar > 0) {
+        return DecodeWorkersCVar;
+    }
+    return FMath::Max(1, FPlatformMisc::NumberOfCoresIncludingHyperthreads() / 2);
+}
+} // namespace
+
+namespace RNBOMetasound {
+
+// starts the loads queued by Submit, on a thread of its own so urgent loads don't wait for a game thread tick
+class FWaveSubmitThread : public FRunnable
+{
+  public:
+    virtual uint32 Run() override
+    {
+        FWaveLoader& Loader = FWaveLoader::Get();
+        while (!bStopping.load()) {
+            Loader.SubmitWake->Wait();
+            Loader.StartSubmitted();
+        }
+        return 0;
+    }
+
+    virtual void Stop() override
+    {
+        bStopping.store(true);
+        FWaveLoader::Get().SubmitWake->Trigger();
+    }
+
+  private:
+    std::atomic<bool> bStopping = false;
+};
+
+namespace {
+FWaveSubmitThread SubmitRunnable;
+TUniquePtr<FRunnableThread> SubmitThread;
+} // namespace
+
+FWaveLoader& FWaveLoader::Get()
+{
+    static FWaveLoader Loader;
+    return Loader;
+}
+
+void FWaveLoadRequest::Publish(const FDecodedWavePtr& Wave, bool bDone)
+{
+    if (Wave.IsValid() && !IsCancelled()) {
+        FScopeLock Guard(&Mutex);
+        Result = Wave;
+        bPublished.store(true);
+    }
+    if (bDone) {
+        bFinished.store(true);
+    }
+}
+
+void FWaveLoadRequest::Reset(bool bInWritable)
+{
+    bWritable = bInWritable;
+    bCancelled.store(false);
+    bPublished.store(false);
+    bFinished.store(false);
+    Result.Reset();
+}
+
+bool FWaveLoadRequest::Poll(FDecodedWavePtr& OutWave)
+{
+    if (!bPublished.load()) {
+        return false;
+    }
+    FScopeLock Guard(&Mutex);
+    OutWave = MoveTemp(Result);
+    bPublished.store(false);
+    return true;
+}
+
+FWaveLoadRequestPool::FWaveLoadRequestPool(int32 Num)
+{
+    for (int32 i = 0; i < Num; i++) {
+        Requests.Add(MakeShared<FWaveLoadRequest, ESPMode::ThreadSafe>());
+    }
+}
+
+FWaveLoadRequestRef FWaveLoadRequestPool::Acquire(bool bWritable)
+{
+    for (FWaveLoadRequestRef& Request : Requests) {
+        // only the pool holds it, the loader and the requester are done with it
+        if (Request.GetSharedReferenceCount() == 1) {
+            Request->Reset(bWritable);
+            return Request;
+        }
+    }
+    return Requests.Add_GetRef(MakeShared<FWaveLoadRequest, ESPMode::ThreadSafe>(bWritable));
+}
+
+bool FWaveLoader::IsAbandoned(FPendingLoad& Load)
+{
+    FScopeLock Guard(&Load.WaitersMutex);
+    for (auto& Waiter : Load.Waiters) {
+        if (!Waiter->IsCancelled()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FWaveLoader::Load(const FSoundWaveProxyPtr& WaveProxy, const FWaveTransform& Transform, ELoadPriority Priority, const FWaveLoadRequestRef& Request)
+{
+    const FWaveCacheKey Key{ WaveProxy->GetFObjectKey(), Transform };
+
+    FScopeLock Guard(&Mutex);
+    if (TSharedPtr<FPendingLoad>* Existing = Pending.Find(Key)) {
+        FPendingLoad& PendingLoad = **Existing;
+        {
+            FScopeLock WaitersGuard(&PendingLoad.WaitersMutex);
+            PendingLoad.Waiters.Add(Request);
+        }
+        // still queued at a lower priority, move it up
+        if (PendingLoad.Job.IsValid() && Priority < PendingLoad.Job->Priority && Queues[static_cast<size_t>(PendingLoad.Job->Priority)].Remove(PendingLoad.Job) > 0) {
+            PendingLoad.Job->Priority = Priority;
+            Queues[static_cast<size_t>(Priority)].Add(PendingLoad.Job);
+        }
+        return;
+    }
+
+    TSharedPtr<FPendingLoad> NewLoad = MakeShared<FPendingLoad>();
+    NewLoad->Waiters.Add(Request);
+    Pending.Add(Key, NewLoad);
+    NewLoad->Job = Enqueue(Priority, [this, Key, WaveProxy, NewLoad]() {
+        {
+            // running now, can't be promoted anymore, also breaks the reference cycle
+            FScopeLock JobGuard(&Mutex);
+            NewLoad->Job.Reset();
+        }
+
+        FDecodedWavePtr Wave;
+        TArray<FWaveLoadRequestRef> Waiters;
+        while (true) {
+            // also checked by the helpers of a segmented decode, on their own threads
+            std::atomic<bool> bAbandoned = false;
+            Wave = FWaveCache::Get().FindOrDecode(WaveProxy, Key.Transform, [&NewLoad, &bAbandoned]() -> bool {
+                if (!bAbandoned.load() && IsAbandoned(*NewLoad)) {
+                    bAbandoned.store(true);
+                }
+                return bAbandoned.load();
+            });
+
+            FScopeLock JobGuard(&Mutex);
+            // a request joined after the decode was given up, decode again rather than leave it without data
+            if (!Wave.IsValid() && bAbandoned.load() && !IsAbandoned(*NewLoad)) {
+                continue;
+            }
+            Pending.Remove(Key);
+            FScopeLock WaitersGuard(&NewLoad->WaitersMutex);
+            Waiters = MoveTemp(NewLoad->Waiters);
+            break;
+        }
+        for (auto& Waiter : Waiters) {
+            // copied here rather than on the audio thread of whoever binds it
+            const bool bCopy = Wave.IsValid() && Waiter->IsWritable() && !Waiter->IsCancelled();
+            Waiter->Publish(bCopy ? CopyWave(*Wave) : Wave, true);
+        }
+    });
+}
+
+void FWaveLoader::Stream(const FSoundWaveProxyPtr& WaveProxy, ELoadPriority Priority, const FWaveLoadRequestRef& Request)
+{
+    Launch(Priority, [WaveProxy, Request]() {
+        FDecodedWavePtr Partial;
+        FDecodedWavePtr Wave = FWaveCache::Get().FindOrStream(
+            WaveProxy,
+            [&Partial, &Request](const FDecodedWavePtr& Chunked) {
+                Partial = Chunked;
+                Request->Publish(Partial, false);
+            },
+            [&Request]() -> bool { return Request->IsCancelled(); },
+            !Request->IsWritable());
+        // only publish again if someone else's decode won the cache, the requester already has ours
+        Request->Publish(Wave != Partial ? Wave : nullptr, true);
+    });
+}
+
+void FWaveLoader::Submit(const FWaveLoadRequestRef& Request, const FSoundWaveProxyPtr& WaveProxy, const FWaveTransform& Transform, bool bStream, ELoadPriority Priority)
+{
+    if (Priority != ELoadPriority::Urgent) {
+        if (bStream) {
+            Stream(WaveProxy, Priority, Request);
+        }
+        else {
+            Load(WaveProxy, Transform, Priority, Request);
+        }
+        return;
+    }
+
+    // only copies into the request, it keeps itself alive until it is started
+    Request->SubmittedProxy = WaveProxy;
+    Request->SubmittedTransform = Transform;
+    Request->SubmittedPriority = Priority;
+    Request->bSubmittedStream = bStream;
+    Request->SubmittedSelf = Request;
+    FWaveLoadRequest* Head = Submitted.load();
+    do {
+        Request->NextSubmitted = Head;
+    } while (!Submitted.compare_exchange_weak(Head, &Request.Get()));
+    // the thread is already on its way if the stack wasn't empty
+    if (Head == nullptr) {
+        SubmitWake->Trigger();
+    }
+}
+
+void FWaveLoader::StartSubmitted()
+{
+    // the stack is newest first, start them in the order they were submitted
+    TArray<FWaveLoadRequestRef, TInlineAllocator<16>> Requests;
+    for (FWaveLoadRequest* It = Submitted.exchange(nullptr); It != nullptr; It = It->NextSubmitted) {
+        Requests.Add(It->SubmittedSelf.ToSharedRef());
+    }
+    for (int32 i = Requests.Num() - 1; i >= 0; i--) {
+        FWaveLoadRequest& Request = *Requests[i];
+        FSoundWaveProxyPtr WaveProxy = MoveTemp(Request.SubmittedProxy);
+        Request.SubmittedSelf.Reset();
+        Request.NextSubmitted = nullptr;
+        if (Request.IsCancelled()) {
+            continue;
+        }
+        if (Request.bSubmittedStream) {
+            Stream(WaveProxy, Request.SubmittedPriority, Requests[i]);
+        }
+        else {
+            Load(WaveProxy, Request.SubmittedTransform, Request.SubmittedPriority, Requests[i]);
+        }
+    }
+}
+
+void FWaveLoader::Launch(ELoadPriority Priority, TUniqueFunction<void()> InWork)
+{
+    FScopeLock Guard(&Mutex);
+    Enqueue(Priority, MoveTemp(InWork));
+}
+
+ELoadPriority FWaveLoader::CurrentPriority()
+{
+    return WorkerPriority;
+}
+
+FWaveLoader::FStats FWaveLoader::GetStats()
+{
+    FScopeLock Guard(&Mutex);
+    FStats Stats;
+    for (auto& Queue : Queues) {
+        Stats.QueueDepth += Queue.Num();
+    }
+    Stats.Running = Running;
+    Stats.Started = Started;
+    Stats.AverageWaitSeconds = Started > 0 ? TotalWaitSeconds / static_cast<double>(Started) : 0.0;
+    Stats.MaxWaitSeconds = MaxWaitSeconds;
+    return Stats;
+}
+
+// expects Mutex to be locked
+TSharedRef<FWaveLoader::FJob> FWaveLoader::Enqueue(ELoadPriority Priority, TUniqueFunction<void()> InWork)
+{
+    TSharedRef<FJob> Job = MakeShared<FJob>();
+    Job->Priority = Priority;
+    Job->QueuedSeconds = FPlatformTime::Seconds();
+    // shutting down, the job is dropped, a segmented decode does the segments of dropped helpers itself
+    if (bStopped) {
+        return Job;
+    }
+    Job->Work = MoveTemp(InWork);
+    Queues[static_cast<size_t>(Priority)].Add(Job);
+
+    if (Running < MaxWorkers()) {
+        Running++;
+        UE::Tasks::Launch(UE_SOURCE_LOCATION, [this]() { Work(); }, UE::Tasks::ETaskPriority::BackgroundHigh);
+    }
+    return Job;
+}
+
+// expects Mutex to be locked
+TSharedPtr<FWaveLoader::FJob> FWaveLoader::Pop()
+{
+    for (auto& Queue : Queues) {
+        if (Queue.Num() > 0) {
+            TSharedPtr<FJob> Job = Queue[0];
+            Queue.RemoveAt(0);
+            return Job;
+        }
+    }
+    return nullptr;
+}
+
+void FWaveLoader::Work()
+{
+    while (true) {
+        TSharedPtr<FJob> Job;
+        {
+            FScopeLock Guard(&Mutex);
+            Job = Pop();
+            if (!Job.IsValid()) {
+                Running--;
+                return;
+            }
+
+            const double Wait = FPlatformTime::Seconds() - Job->QueuedSeconds;
+            Started++;
+            TotalWaitSeconds += Wait;
+            MaxWaitSeconds = FMath::Max(MaxWaitSeconds, Wait);
+        }
+        WorkerPriority = Job->Priority;
+        Job->Work();
+        WorkerPriority = ELoadPriority::Normal;
+    }
+}
+
+void StartWaveLoader()
+{
+    SubmitThread.Reset(FRunnableThread::Create(&SubmitRunnable, TEXT("RNBOWaveSubmit"), 0, TPri_BelowNormal));
+}
+
+void StopWaveLoader()
+{
+    if (SubmitThread.IsValid()) {
+        SubmitThread->Kill(true);
+        SubmitThread.Reset();
+    }
+
+    // drop whatever is still queued, nobody will pick it up anymore
+    FWaveLoader& Loader = FWaveLoader::Get();
+    for (FWaveLoadRequest* It = Loader.Submitted.exchange(nullptr); It != nullptr;) {
+        FWaveLoadRequest* Next = It->NextSubmitted;
+        It->SubmittedProxy.Reset();
+        It->SubmittedSelf.Reset();
+        It = Next;
+    }
+
+    // running decodes stop at their next chunk once every waiter is cancelled, queued jobs never start
+    TArray<TSharedPtr<FWaveLoader::FJob>> Dropped;
+    {
+        FScopeLock Guard(&Loader.Mutex);
+        Loader.bStopped = true;
+        for (auto& It : Loader.Pending) {
+            FScopeLock WaitersGuard(&It.Value->WaitersMutex);
+            for (auto& Waiter : It.Value->Waiters) {
+                Waiter->Cancel();
+            }
+            // a queued load and its job hold each other
+            It.Value->Job.Reset();
+        }
+        for (auto& Queue : Loader.Queues) {
+            Dropped.Append(MoveTemp(Queue));
+            Queue.Reset();
+        }
+    }
+    Dropped.Empty();
+
+    // jobs use module code, wait for them like the core object pools wait for their tasks
+    while (true) {
+        {
+            FScopeLock Guard(&Loader.Mutex);
+            if (Loader.Running == 0) {
+                break;
+            }
+        }
+        FPlatformProcess::Sleep(0.001f);
+    }
+    FScopeLock Guard(&Loader.Mutex);
+    Loader.Pending.Empty();
+}
+
+} // namespace RNBOMetasound
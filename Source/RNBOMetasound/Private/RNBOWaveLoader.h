@@ -0,0 +1,169 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RNBOWaveCache.h"
+#include <atomic>
+
+namespace RNBOMetasound {
+
+enum class ELoadPriority : uint8
+{
+    // a node that is already running needs the data
+    Urgent,
+    // a node is being constructed
+    Normal,
+    // nobody is waiting on the data yet
+    Background,
+    Count
+};
+
+// the only thing shared between whoever asked for a load and the worker doing it
+// the worker publishes decoded data here, the requester picks it up on its own thread
+class FWaveLoadRequest
+{
+  public:
+    // a writable request is published its own copy of the data, for a patch that writes to its buffer
+    explicit FWaveLoadRequest(bool bInWritable = false)
+        : bWritable(bInWritable)
+    {
+    }
+
+    bool IsWritable() const { return bWritable; }
+
+    // back to the state of a new request, only while nobody but the caller holds it
+    void Reset(bool bInWritable);
+
+    // stop the decode at the next chunk boundary, nothing is published after this
+    void Cancel() { bCancelled.store(true); }
+    bool IsCancelled() const { return bCancelled.load(); }
+
+    // worker side, bDone marks the last publish of this request, publishing nullptr only marks it done
+    void Publish(const FDecodedWavePtr& Wave, bool bDone);
+
+    // requester side, lock free unless something was published since the last poll
+    // returns true and the newest data if there is any
+    bool Poll(FDecodedWavePtr& OutWave);
+    bool IsDone() const { return bFinished.load(); }
+
+  private:
+    friend class FWaveLoader;
+
+    bool bWritable;
+    std::atomic<bool> bCancelled = false;
+    std::atomic<bool> bPublished = false;
+    std::atomic<bool> bFinished = false;
+    FCriticalSection Mutex;
+    FDecodedWavePtr Result;
+
+    // what to load, while the request waits in FWaveLoader::Submit's queue
+    FSoundWaveProxyPtr SubmittedProxy;
+    FWaveTransform SubmittedTransform;
+    ELoadPriority SubmittedPriority = ELoadPriority::Urgent;
+    bool bSubmittedStream = false;
+    TSharedPtr<FWaveLoadRequest, ESPMode::ThreadSafe> SubmittedSelf;
+    FWaveLoadRequest* NextSubmitted = nullptr;
+};
+
+using FWaveLoadRequestRef = TSharedRef<FWaveLoadRequest, ESPMode::ThreadSafe>;
+using FWaveLoadRequestPtr = TSharedPtr<FWaveLoadRequest, ESPMode::ThreadSafe>;
+
+// requests made up front and reused once nobody else holds them, so starting a load on the audio thread doesn't allocate
+class FWaveLoadRequestPool
+{
+  public:
+    explicit FWaveLoadRequestPool(int32 Num);
+
+    // a request in its initial state, only allocates if every request made so far is still in use
+    FWaveLoadRequestRef Acquire(bool bWritable);
+
+  private:
+    TArray<FWaveLoadRequestRef> Requests;
+};
+
+// bounded pool of workers that decode wave assets, independent assets are decoded concurrently
+// the number of workers is set with au.RNBO.DecodeWorkers and the stats are logged with au.RNBO.DecodeStats
+class FWaveLoader
+{
+  public:
+    struct FStats
+    {
+        int32 QueueDepth = 0;
+        int32 Running = 0;
+        uint64 Started = 0;
+        double AverageWaitSeconds = 0.0;
+        double MaxWaitSeconds = 0.0;
+    };
+
+    static FWaveLoader& Get();
+
+    // decode and transform WaveProxy into the wave cache and publish it to Request
+    // requests for an asset and transform that is already queued or decoding join that load, raising its priority if needed
+    // the load is only cancelled once every request that joined it is
+    void Load(const FSoundWaveProxyPtr& WaveProxy, const FWaveTransform& Transform, ELoadPriority Priority, const FWaveLoadRequestRef& Request);
+
+    // like Load but with FWaveCache::FindOrStream, the partial block is published after the first chunk
+    // a writable request decodes into a block of its own that is never cached
+    void Stream(const FSoundWaveProxyPtr& WaveProxy, ELoadPriority Priority, const FWaveLoadRequestRef& Request);
+
+    // run an arbitrary job on the pool
+    void Launch(ELoadPriority Priority, TUniqueFunction<void()> InWork);
+
+    // the priority of the job running on the calling thread, Normal off the pool
+    // for jobs that launch helpers of their own
+    static ELoadPriority CurrentPriority();
+
+    // Load, or Stream if bStream is set, for callers on the audio thread
+    // urgent requests come from nodes that are running, they are only queued here, without allocating, and the submit thread is woken to start them
+    // any other request is started right away
+    void Submit(const FWaveLoadRequestRef& Request, const FSoundWaveProxyPtr& WaveProxy, const FWaveTransform& Transform, bool bStream, ELoadPriority Priority);
+
+    FStats GetStats();
+
+  private:
+    struct FJob
+    {
+        TUniqueFunction<void()> Work;
+        ELoadPriority Priority;
+        double QueuedSeconds;
+    };
+
+    struct FPendingLoad
+    {
+        // guards Waiters, so checking for cancellation between chunks doesn't take the loader's lock
+        FCriticalSection WaitersMutex;
+        TArray<FWaveLoadRequestRef> Waiters;
+        TSharedPtr<FJob> Job; // only valid while queued
+    };
+
+    friend void StartWaveLoader();
+    friend void StopWaveLoader();
+    friend class FWaveSubmitThread;
+
+    TSharedRef<FJob> Enqueue(ELoadPriority Priority, TUniqueFunction<void()> InWork);
+    TSharedPtr<FJob> Pop();
+    void Work();
+    void StartSubmitted();
+    static bool IsAbandoned(FPendingLoad& Load);
+
+    FCriticalSection Mutex;
+    TArray<TSharedPtr<FJob>> Queues[static_cast<size_t>(ELoadPriority::Count)];
+    TMap<FWaveCacheKey, TSharedPtr<FPendingLoad>> Pending;
+    // lock free stack of the requests queued by Submit
+    std::atomic<FWaveLoadRequest*> Submitted = nullptr;
+    // triggered by Submit, waited on by the submit thread, triggering doesn't allocate
+    FEventRef SubmitWake{ EEventMode::AutoReset };
+    // set by StopWaveLoader, nothing is queued after this
+    bool bStopped = false;
+
+    int32 Running = 0;
+    uint64 Started = 0;
+    double TotalWaitSeconds = 0.0;
+    double MaxWaitSeconds = 0.0;
+};
+
+// submitted loads are started from a thread of their own, started and stopped with the module
+// stopping cancels every load, drops what is queued and waits for the running jobs
+void StartWaveLoader();
+void StopWaveLoader();
+
+} // namespace RNBOMetasound
@@ -0,0 +1,93 @@
+#include "RNBOWavePreloadSubsystem.h"
+#include "RNBOWaveCache.h"
+#include "RNBOWaveLoader.h"
+
+#include "Sound/SoundWave.h"
+
+using namespace RNBOMetasound;
+
+void URNBOWavePreloadSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+    Super::Initialize(Collection);
+    TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &URNBOWavePreloadSubsystem::Tick));
+}
+
+void URNBOWavePreloadSubsystem::Deinitialize()
+{
+    FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+    ReleaseAllWaves();
+    Super::Deinitialize();
+}
+
+void URNBOWavePreloadSubsystem::PrefetchWaves(const TArray<USoundWave*>& Waves)
+{
+    for (USoundWave* Wave : Waves) {
+        if (Wave == nullptr) {
+            continue;
+        }
+        FSoundWaveProxyPtr WaveProxy = Wave->CreateSoundWaveProxy();
+        if (!WaveProxy.IsValid()) {
+            continue;
+        }
+        const FObjectKey Key = WaveProxy->GetFObjectKey();
+        if (Ready.Contains(Key) || Loading.Contains(Key)) {
+            continue;
+        }
+
+        // untransformed, pins with a transform make theirs from this when their node is constructed, without decoding again
+        if (FDecodedWavePtr Decoded = FWaveCache::Get().Find({ Key, FWaveTransform() })) {
+            Ready.Add(Key, Decoded);
+            continue;
+        }
+
+        // nodes that need the same wave in the meantime join this decode and raise its priority
+        FWaveLoadRequestRef Request = MakeShared<FWaveLoadRequest, ESPMode::ThreadSafe>();
+        FWaveLoader::Get().Load(WaveProxy, FWaveTransform(), ELoadPriority::Background, Request);
+        Loading.Add(Key, Request);
+    }
+}
+
+void URNBOWavePreloadSubsystem::ReleaseWaves(const TArray<USoundWave*>& Waves)
+{
+    for (USoundWave* Wave : Waves) {
+        if (Wave == nullptr) {
+            continue;
+        }
+        const FObjectKey Key(Wave);
+        Ready.Remove(Key);
+        FWaveLoadRequestPtr Request;
+        if (Loading.RemoveAndCopyValue(Key, Request)) {
+            Request->Cancel();
+        }
+    }
+}
+
+void URNBOWavePreloadSubsystem::ReleaseAllWaves()
+{
+    for (auto& It : Loading) {
+        It.Value->Cancel();
+    }
+    Loading.Empty();
+    Ready.Empty();
+}
+
+bool URNBOWavePreloadSubsystem::IsWaveReady(USoundWave* Wave) const
+{
+    return Wave != nullptr && Ready.Contains(FObjectKey(Wave));
+}
+
+bool URNBOWavePreloadSubsystem::Tick(float DeltaTime)
+{
+    for (auto It = Loading.CreateIterator(); It; ++It) {
+        FWaveLoadRequest& Request = *It->Value;
+        const bool bDone = Request.IsDone();
+        FDecodedWavePtr Decoded;
+        if (Request.Poll(Decoded)) {
+            Ready.Add(It->Key, Decoded);
+        }
+        if (bDone) {
+            It.RemoveCurrent();
+        }
+    }
+    return true;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Curves/CurveFloat.h"
+#include "IAudioProxyInitializer.h"
+#include "MetasoundDataReferenceMacro.h"
+
+#include "RNBODataAsset.generated.h"
+
+namespace RNBOMetasound {
+
+struct FDecodedWave;
+using FDecodedWavePtr = TSharedPtr<FDecodedWave, ESPMode::ThreadSafe>;
+
+// the values of a data asset, made once per asset and shared read only by every node using it
+// held as waves so binding them and dropping the last reference work like they do for wave assets
+struct FBakedData
+{
+    // what float32 and untyped data objects bind
+    FDecodedWavePtr Float32;
+
+    // the values as doubles, converted the first time a float64 data object asks for them
+    // that is when the node is built if the asset is on the pin already, the samples hold the bytes of the doubles
+    FDecodedWavePtr GetFloat64() const;
+
+  private:
+    mutable FCriticalSection Float64Mutex;
+    mutable FDecodedWavePtr Float64;
+};
+
+using FBakedDataPtr = TSharedPtr<const FBakedData, ESPMode::ThreadSafe>;
+
+class RNBOMETASOUND_API FDataAssetProxy : public Audio::TProxyData<FDataAssetProxy>
+{
+  public:
+    IMPL_AUDIOPROXY_CLASS(FDataAssetProxy);
+
+    explicit FDataAssetProxy(FBakedDataPtr InData)
+        : Data(MoveTemp(InData))
+    {
+    }
+
+    const FBakedDataPtr& GetData() const { return Data; }
+
+  private:
+    FBakedDataPtr Data;
+};
+
+using FDataAssetProxyPtr = TSharedPtr<FDataAssetProxy, ESPMode::ThreadSafe>;
+
+// the MetaSound side of a URNBODataAsset, what RNBO data pins take
+class RNBOMETASOUND_API FDataAsset
+{
+  public:
+    FDataAsset() = default;
+    FDataAsset(const TSharedPtr<Audio::IProxyData>& InInitData);
+
+    const FDataAssetProxyPtr& GetProxy() const { return Proxy; }
+
+  private:
+    FDataAssetProxyPtr Proxy;
+};
+
+} // namespace RNBOMetasound
+
+DECLARE_METASOUND_DATA_REFERENCE_TYPES(RNBOMetasound::FDataAsset, RNBOMETASOUND_API, FDataAssetTypeInfo, FDataAssetReadRef, FDataAssetWriteRef);
+
+/**
+ * A table of values for the data objects of RNBO patches, connected to the data pins of RNBO nodes.
+ * The values are computed once and shared by every node, only data objects declared readonly get a pin.
+ */
+UCLASS(BlueprintType)
+class RNBOMETASOUND_API URNBODataAsset : public UDataAsset, public IAudioProxyDataFactory
+{
+    GENERATED_BODY()
+
+  public:
+    /** The values, used as is. */
+    UPROPERTY(EditAnywhere, Category = "RNBO")
+    TArray<float> Values;
+
+    /** Used when Values is empty, sampled evenly over its time range. */
+    UPROPERTY(EditAnywhere, Category = "RNBO")
+    TObjectPtr<UCurveFloat> Curve;
+
+    /** How many values to sample from Curve. */
+    UPROPERTY(EditAnywhere, Category = "RNBO", meta = (ClampMin = "1"))
+    int32 CurveSamples = 1024;
+
+    virtual TSharedPtr<Audio::IProxyData> CreateProxyData(const Audio::FProxyDataInitParams& InitParams) override;
+
+#if WITH_EDITOR
+    virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+  private:
+    RNBOMetasound::FBakedDataPtr Bake() const;
+
+    RNBOMetasound::FBakedDataPtr Baked;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "Containers/Ticker.h"
+#include "UObject/ObjectKey.h"
+
+#include "RNBOWavePreloadSubsystem.generated.h"
+
+class USoundWave;
+
+namespace RNBOMetasound {
+struct FDecodedWave;
+class FWaveLoadRequest;
+} // namespace RNBOMetasound
+
+/**
+ * Decodes wave assets for RNBO nodes ahead of time, for instance at level streaming or before a cinematic starts.
+ * RNBO nodes constructed afterwards bind the decoded data right away instead of waiting on a decode,
+ * pins that transform the data or that the patch writes to get theirs made from it while the node is constructed.
+ * Prefetched data stays in memory until it is released.
+ */
+UCLASS()
+class RNBOMETASOUND_API URNBOWavePreloadSubsystem : public UEngineSubsystem
+{
+    GENERATED_BODY()
+
+  public:
+    virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+    virtual void Deinitialize() override;
+
+    /** Start decoding the given waves in the background. */
+    UFUNCTION(BlueprintCallable, Category = "RNBO")
+    void PrefetchWaves(const TArray<USoundWave*>& Waves);
+
+    /** Let go of prefetched waves, their data is freed once no RNBO node uses it. */
+    UFUNCTION(BlueprintCallable, Category = "RNBO")
+    void ReleaseWaves(const TArray<USoundWave*>& Waves);
+
+    /** Let go of every prefetched wave. */
+    UFUNCTION(BlueprintCallable, Category = "RNBO")
+    void ReleaseAllWaves();
+
+    /** True once the given wave has been prefetched and decoded. */
+    UFUNCTION(BlueprintPure, Category = "RNBO")
+    bool IsWaveReady(USoundWave* Wave) const;
+
+  private:
+    bool Tick(float DeltaTime);
+
+    TMap<FObjectKey, TSharedPtr<RNBOMetasound::FWaveLoadRequest, ESPMode::ThreadSafe>> Loading;
+    TMap<FObjectKey, TSharedPtr<RNBOMetasound::FDecodedWave, ESPMode::ThreadSafe>> Ready;
+    FTSTicker::FDelegateHandle TickerHandle;
+};
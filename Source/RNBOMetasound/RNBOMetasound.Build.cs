@@ -6,14 +6,19 @@ using System;
 using System.IO;
 using System.Globalization;
 using System.Text;
+using System.Text.Json;
 using System.Text.RegularExpressions;
 using System.Collections.Generic;
+using Microsoft.Extensions.Logging;
 
 
 public class RNBOMetasound : ModuleRules
 {
 	string OperatorTemplate { get; set; }
 
+	//larger files make for slow builds and are better off as WaveAssets
+	const int MaxEmbeddedSamples = 1 << 20;
+
 	public RNBOMetasound(ReadOnlyTargetRules Target) : base(Target)
 	{
 		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
@@ -95,10 +100,13 @@ public class RNBOMetasound : ModuleRules
 			new string[]
 			{
 				"Core",
+				"CoreUObject",
+				"Engine",
 				"MetasoundFrontend",
 				"MetasoundGraphCore",
 				"MetasoundStandardNodes",
 				"MetasoundEngine",
+				"AudioExtensions",
 				"Harmonix",
 				"HarmonixMetasound",
 				"HarmonixMidi",
@@ -110,9 +118,8 @@ public class RNBOMetasound : ModuleRules
 		PrivateDependencyModuleNames.AddRange(
 			new string[]
 			{
-				"CoreUObject",
-				"Engine",
 				"SignalProcessing",
+				"AudioMixerCore",
 				// ... add private dependencies that you statically link with here ...
 			}
 			);
@@ -130,17 +137,479 @@ public class RNBOMetasound : ModuleRules
 
 	string CreateMetaSound(string path) {
 		var descPath = Path.Combine(path, "description.json");
-		string descString = File.ReadAllText(descPath);
-
-		//get the name
-		JsonObject desc = JsonObject.Parse(descString);
-		var meta = desc.GetObjectField("meta");
-		string name = meta.GetStringField("rnboobjname");
-
-		return OperatorTemplate
-			.Replace("_OPERATOR_NAME_", name)
-			//TODO chunk for windows
-			.Replace("_OPERATOR_DESC_", String.Format("R\"RNBOLIT({0})RNBOLIT\"", descString))
-			;
+		using (JsonDocument doc = JsonDocument.Parse(File.ReadAllText(descPath)))
+		{
+			JsonElement desc = doc.RootElement;
+
+			//get the name
+			string name = StringField(desc.GetProperty("meta"), "rnboobjname", null);
+
+			return OperatorTemplate
+				.Replace("_OPERATOR_NAME_", name)
+				.Replace("_OPERATOR_DESC_", CreateDescription(desc))
+				.Replace("_OPERATOR_EMBEDDED_", CreateEmbeddedBuffers(path, desc))
+				;
+		}
+	}
+
+	//the parts of description.json the operator uses, as constexpr tables so nothing is parsed at runtime
+	string CreateDescription(JsonElement desc) {
+		var code = new StringBuilder();
+		code.Append("struct Desc\n{\n");
+
+		JsonElement meta = desc.GetProperty("meta");
+		string className = StringField(meta, "rnboobjname", null);
+		string displayName = StringField(meta, "name", "");
+		if (displayName.Length == 0 || displayName == "untitled") {
+			displayName = className;
+		}
+		code.AppendFormat("\tstatic constexpr const char* ClassName = {0};\n", CString(className));
+		code.AppendFormat("\tstatic constexpr const char* DisplayName = {0};\n", CString(displayName));
+		code.AppendFormat("\tstatic constexpr bool Transport = {0};\n", BoolLiteral(BoolField(desc, "transportUsed", true)));
+		code.AppendFormat("\tstatic constexpr bool MIDIIn = {0};\n", BoolLiteral(IntField(desc, "numMidiInputPorts", 0) > 0));
+		code.AppendFormat("\tstatic constexpr bool MIDIOut = {0};\n", BoolLiteral(IntField(desc, "numMidiOutputPorts", 0) > 0));
+
+		//every parameter counts towards the indices, only visible numeric ones get pins
+		var parameters = new List<string>();
+		//param~ with a signal inlet, ordered by signal index, their audio pins come after the in~ inlets
+		//the signal index is their channel in the core object's inputs
+		var paramSignals = new SortedList<int, string>();
+		//the names a param~ signal inlet can be listed under with the in~ inlets, an in~ inlet never shares them
+		var paramSignalTags = new HashSet<string>();
+		int numParameters = 0;
+		foreach (var p in ArrayField(desc, "parameters")) {
+			numParameters++;
+			string paramName = StringField(p, "name", "");
+			string paramDisplayName = StringField(p, "displayName", "");
+			if (paramDisplayName.Length == 0) {
+				paramDisplayName = paramName;
+			}
+			int signalIndex = IntField(p, "signalIndex", -1);
+			if (signalIndex >= 0 && !paramSignals.ContainsKey(signalIndex)) {
+				paramSignals.Add(signalIndex, String.Format("{{ {0}, {1}, {2}, {3}, {4} }}",
+					IntField(p, "index", 0), CString(paramName + "~"), CString(paramDisplayName + "~"), CString(StringField(p, "paramId", paramName)), signalIndex));
+				paramSignalTags.Add(paramName);
+				paramSignalTags.Add(paramName + "~");
+				paramSignalTags.Add(StringField(p, "paramId", paramName));
+			}
+			if (StringField(p, "type", "") != "ParameterTypeNumber" || !BoolField(p, "visible", true)) {
+				continue;
+			}
+			string type = IsBoolParam(p) ? "Bool" : BoolField(p, "isEnum", false) ? "Int" : "Float";
+			JsonElement paramMeta;
+			bool input = !TryObjectField(p, "meta", out paramMeta) || BoolField(paramMeta, "in", true);
+			bool output = TryObjectField(p, "meta", out paramMeta) && BoolField(paramMeta, "out", false);
+			if (!input && !output) {
+				continue;
+			}
+			parameters.Add(String.Format("{{ {0}, {1}, {2}, {3}, {4}, EParamType::{5}, {6}, {7} }}",
+				IntField(p, "index", 0), CString(paramName), CString(paramDisplayName), CString(StringField(p, "paramId", paramName)),
+				FloatLiteral(NumberField(p, "initialValue", 0.0)), type, BoolLiteral(input), BoolLiteral(output)));
+		}
+		//a param without a name doesn't make an untagged in~ inlet a param~ one
+		paramSignalTags.Remove("");
+		code.AppendFormat("\tstatic constexpr size_t NumParameters = {0};\n", numParameters);
+		AppendTable(code, "FParamDesc", "Parameters", parameters);
+		AppendTable(code, "FParamSignalDesc", "ParamSignals", new List<string>(paramSignals.Values));
+
+		foreach (var ports in new string[] { "inports", "outports" }) {
+			var entries = new List<string>();
+			foreach (var p in ArrayField(desc, ports)) {
+				entries.Add(String.Format("{{ {0} }}", CString(StringField(p, "tag", ""))));
+			}
+			AppendTable(code, "FPortDesc", ports == "inports" ? "Inports" : "Outports", entries);
+		}
+
+		foreach (var signals in new string[] { "inlets", "outlets" }) {
+			var entries = new List<string>();
+			//signal inlets and outlets are the core object's channels in the order they are listed
+			int channel = 0;
+			foreach (var p in ArrayField(desc, signals)) {
+				if (StringField(p, "type", "") != "signal") {
+					continue;
+				}
+				int signalChannel = channel++;
+				string tag = StringField(p, "tag", "");
+				JsonElement signalMeta;
+				bool hasMeta = TryObjectField(p, "meta", out signalMeta);
+				//a param~ signal inlet listed with the in~ inlets already has its pin, it is known by its tag or its meta naming the param
+				//not by its channel, an in~ inlet can have the same index as a param~ signal
+				if (signals == "inlets" && (paramSignalTags.Contains(tag) || (hasMeta && paramSignalTags.Contains(StringField(signalMeta, "param", ""))))) {
+					continue;
+				}
+				string signalDisplayName = StringField(p, "comment", tag);
+				string tooltip = tag;
+				if (hasMeta) {
+					signalDisplayName = StringField(signalMeta, "displayname", signalDisplayName);
+					tooltip = StringField(signalMeta, "tooltip", tooltip);
+				}
+				entries.Add(String.Format("{{ {0}, {1}, {2}, {3} }}", CString(tag), CString(signalDisplayName), CString(tooltip), signalChannel));
+			}
+			AppendTable(code, "FSignalDesc", signals == "inlets" ? "InputSignals" : "OutputSignals", entries);
+			if (signals == "inlets") {
+				int numInputChannels = paramSignals.Count > 0 ? Math.Max(channel, paramSignals.Keys[paramSignals.Count - 1] + 1) : channel;
+				code.AppendFormat("\tstatic constexpr size_t NumInputChannels = {0};\n", numInputChannels);
+			}
+		}
+
+		var dataRefs = new List<string>();
+		int dataRefIndex = 0;
+		foreach (var r in ArrayField(desc, "externalDataRefs")) {
+			int index = dataRefIndex++;
+			//buffer~ and data are supported, a dataref without a tag is taken as a buffer~
+			string tag = StringField(r, "tag", "buffer~");
+			if (tag != "buffer~" && tag != "data") {
+				continue;
+			}
+			string bufferType = "Float32";
+			switch (StringField(r, "type", "")) {
+				case "Float64Buffer":
+				case "Float64AudioBuffer":
+					bufferType = "Float64";
+					break;
+				case "UntypedDataBuffer":
+					bufferType = "Untyped";
+					break;
+			}
+			JsonElement refMeta;
+			if (!TryObjectField(r, "meta", out refMeta)) {
+				refMeta = default(JsonElement);
+			}
+			//data assets are shared between nodes, a patch that may write into its data keeps it to itself
+			if (tag == "data" && !BoolField(refMeta, "readonly", false)) {
+				Logger.LogWarning("RNBOMetasound: data {Id} has no RNBODataAsset pin, declare it with @meta readonly:true to get one", StringField(r, "id", ""));
+				continue;
+			}
+			//1 based, like the channels of buffer~
+			int channel = IntField(refMeta, "channel", 0);
+			string share = StringField(refMeta, "share", null);
+			//the size of a shared buffer, nothing else has one
+			int shareFrames = share == null ? 0 : Math.Max(0, IntField(refMeta, "frames", 0));
+			int shareChannels = share == null ? 1 : Math.Max(1, IntField(refMeta, "channels", 1));
+			dataRefs.Add(String.Format("{{ {0}, {1}, EDataRefKind::{2}, EDataBufferType::{3}, {4}, {5}, {6}, {7}, {8}, {9}, {10}, {11}, {12}, {13}, {14} }}",
+				CString(StringField(r, "id", "")), index, tag == "data" ? "Data" : "Wave", bufferType,
+				BoolLiteral(BoolField(refMeta, "readonly", false)),
+				BoolLiteral(BoolField(refMeta, "stream", false)),
+				Math.Max(0, IntField(refMeta, "startframe", 0)),
+				Math.Max(0, IntField(refMeta, "endframe", 0)),
+				channel > 0 ? channel - 1 : -1,
+				BoolLiteral(BoolField(refMeta, "downmix", false)),
+				BoolLiteral(BoolField(refMeta, "resample", false)),
+				BoolLiteral(BoolField(refMeta, "bank", false)),
+				share == null ? "nullptr" : CString(share),
+				shareFrames,
+				shareChannels));
+		}
+		AppendTable(code, "FDataRefDesc", "DataRefs", dataRefs);
+
+		code.Append("};\n");
+		return code.ToString();
+	}
+
+	//a parameter with @enum 0 1
+	static bool IsBoolParam(JsonElement p) {
+		JsonElement values;
+		if (IntField(p, "steps", 0) != 2 || p.ValueKind != JsonValueKind.Object || !p.TryGetProperty("enumValues", out values) || values.ValueKind != JsonValueKind.Array || values.GetArrayLength() < 2) {
+			return false;
+		}
+		return values[0].ValueKind == JsonValueKind.Number && values[1].ValueKind == JsonValueKind.Number && values[0].GetDouble() == 0.0 && values[1].GetDouble() == 1.0;
+	}
+
+	static void AppendTable(StringBuilder code, string type, string name, List<string> entries) {
+		code.AppendFormat("\tstatic constexpr std::array<{0}, {1}> {2} = {{{{", type, entries.Count, name);
+		foreach (var e in entries) {
+			code.Append("\n\t\t");
+			code.Append(e);
+			code.Append(",");
+		}
+		code.Append(entries.Count > 0 ? "\n\t}};\n" : "}};\n");
+	}
+
+	static IEnumerable<JsonElement> ArrayField(JsonElement e, string name) {
+		JsonElement v;
+		if (e.ValueKind == JsonValueKind.Object && e.TryGetProperty(name, out v) && v.ValueKind == JsonValueKind.Array) {
+			return v.EnumerateArray();
+		}
+		return new JsonElement[0];
+	}
+
+	static bool TryObjectField(JsonElement e, string name, out JsonElement v) {
+		v = default(JsonElement);
+		return e.ValueKind == JsonValueKind.Object && e.TryGetProperty(name, out v) && v.ValueKind == JsonValueKind.Object;
+	}
+
+	static string StringField(JsonElement e, string name, string fallback) {
+		JsonElement v;
+		if (e.ValueKind == JsonValueKind.Object && e.TryGetProperty(name, out v) && v.ValueKind == JsonValueKind.String) {
+			return v.GetString();
+		}
+		return fallback;
+	}
+
+	static bool BoolField(JsonElement e, string name, bool fallback) {
+		JsonElement v;
+		if (e.ValueKind == JsonValueKind.Object && e.TryGetProperty(name, out v) && (v.ValueKind == JsonValueKind.True || v.ValueKind == JsonValueKind.False)) {
+			return v.GetBoolean();
+		}
+		return fallback;
+	}
+
+	static double NumberField(JsonElement e, string name, double fallback) {
+		JsonElement v;
+		if (e.ValueKind == JsonValueKind.Object && e.TryGetProperty(name, out v) && v.ValueKind == JsonValueKind.Number) {
+			return v.GetDouble();
+		}
+		return fallback;
+	}
+
+	static int IntField(JsonElement e, string name, int fallback) {
+		return (int)NumberField(e, name, fallback);
+	}
+
+	static string BoolLiteral(bool v) {
+		return v ? "true" : "false";
+	}
+
+	//a C++ string literal, anything but printable ASCII is escaped as octal so the bytes stay UTF-8
+	static string CString(string s) {
+		var lit = new StringBuilder("\"");
+		foreach (byte b in Encoding.UTF8.GetBytes(s)) {
+			if (b == '"' || b == '\\') {
+				lit.Append('\\');
+				lit.Append((char)b);
+			} else if (b < 0x20 || b >= 0x7F) {
+				lit.Append('\\');
+				lit.Append(Convert.ToString(b, 8).PadLeft(3, '0'));
+			} else {
+				lit.Append((char)b);
+			}
+		}
+		lit.Append('"');
+		return lit.ToString();
+	}
+
+	//find the files of buffer~ objects with @file, from dependencies.json if the export copied them, or from the description
+	Dictionary<string, string> BufferFiles(string path, JsonElement desc) {
+		var files = new Dictionary<string, string>();
+		var embeddable = new HashSet<string>();
+
+		foreach (var r in ArrayField(desc, "externalDataRefs")) {
+			string id = StringField(r, "id", null);
+			if (id == null || StringField(r, "tag", "buffer~") != "buffer~") {
+				continue;
+			}
+			//embedding is opt in with @meta embed:true
+			JsonElement refMeta;
+			if (!TryObjectField(r, "meta", out refMeta) || !BoolField(refMeta, "embed", false)) {
+				continue;
+			}
+			embeddable.Add(id);
+			string file = StringField(r, "file", "");
+			if (file.Length > 0) {
+				files[id] = file;
+			}
+		}
+
+		var depsPath = Path.Combine(path, "dependencies.json");
+		if (File.Exists(depsPath)) {
+			using (JsonDocument deps = JsonDocument.Parse(File.ReadAllText(depsPath)))
+			{
+				if (deps.RootElement.ValueKind == JsonValueKind.Array) {
+					foreach (var d in deps.RootElement.EnumerateArray()) {
+						string id = StringField(d, "id", null);
+						string file = StringField(d, "file", null);
+						if (id != null && file != null && embeddable.Contains(id)) {
+							files[id] = file;
+						}
+					}
+				}
+			}
+		}
+
+		var resolved = new Dictionary<string, string>();
+		foreach (var it in files) {
+			foreach (var candidate in new string[] { Path.Combine(path, it.Value), Path.Combine(path, "media", Path.GetFileName(it.Value)) }) {
+				if (File.Exists(candidate)) {
+					resolved[it.Key] = candidate;
+					break;
+				}
+			}
+			if (!resolved.ContainsKey(it.Key)) {
+				Logger.LogWarning("RNBOMetasound: cannot find {File} for buffer~ {Id} in {Path}, it will not be embedded", it.Value, it.Key, path);
+			}
+		}
+		return resolved;
+	}
+
+	string CreateEmbeddedBuffers(string path, JsonElement desc) {
+		var code = new StringBuilder();
+		var entries = new List<string>();
+
+		foreach (var it in BufferFiles(path, desc)) {
+			float[] samples;
+			int channels;
+			double sampleRate;
+			if (!ReadAudioFile(it.Value, out samples, out channels, out sampleRate)) {
+				Logger.LogWarning("RNBOMetasound: {File} is not a PCM or float WAV or AIFF file, buffer~ {Id} will not be embedded", it.Value, it.Key);
+				continue;
+			}
+			if (samples.Length > MaxEmbeddedSamples) {
+				Logger.LogWarning("RNBOMetasound: {File} has more than {Max} samples, buffer~ {Id} will not be embedded, use a WaveAsset instead", it.Value, MaxEmbeddedSamples, it.Key);
+				continue;
+			}
+			ExternalDependencies.Add(it.Value);
+
+			string dataName = String.Format("EmbeddedData{0}", entries.Count);
+			code.AppendFormat("const float {0}[] = {{", dataName);
+			for (int i = 0; i < samples.Length; i++) {
+				if (i % 16 == 0) {
+					code.Append("\n\t");
+				}
+				code.Append(FloatLiteral(samples[i]));
+				code.Append(", ");
+			}
+			code.Append("\n};\n");
+			entries.Add(String.Format(CultureInfo.InvariantCulture, "{{ {0}, {1}, {2}, {3}, {4} }}", CString(it.Key), dataName, samples.Length, channels, FloatLiteral(sampleRate)));
+		}
+
+		if (entries.Count == 0) {
+			code.Append("const FEmbeddedBuffers embedded = { nullptr, 0 };\n");
+		} else {
+			code.AppendFormat("const FEmbeddedBuffer EmbeddedBufferList[] = {{ {0} }};\n", String.Join(", ", entries));
+			code.AppendFormat("const FEmbeddedBuffers embedded = {{ EmbeddedBufferList, {0} }};\n", entries.Count);
+		}
+		return code.ToString();
+	}
+
+	static string FloatLiteral(double v) {
+		string s = ((float)v).ToString("R", CultureInfo.InvariantCulture);
+		if (s.IndexOfAny(new char[] { '.', 'E' }) < 0) {
+			s += ".0";
+		}
+		return s + "f";
+	}
+
+	//interleaved float samples from an uncompressed WAV or AIFF file
+	static bool ReadAudioFile(string file, out float[] samples, out int channels, out double sampleRate) {
+		samples = null;
+		channels = 0;
+		sampleRate = 0.0;
+
+		byte[] data = File.ReadAllBytes(file);
+		if (data.Length < 12) {
+			return false;
+		}
+		string riff = Encoding.ASCII.GetString(data, 0, 4);
+		string form = Encoding.ASCII.GetString(data, 8, 4);
+
+		bool bigEndian;
+		bool isFloat = false;
+		int bits = 0;
+		int dataOffset = -1;
+		int dataSize = 0;
+		if (riff == "RIFF" && form == "WAVE") {
+			bigEndian = false;
+			for (int pos = 12; pos + 8 <= data.Length;) {
+				string id = Encoding.ASCII.GetString(data, pos, 4);
+				int size = (int)ReadUInt(data, pos + 4, 4, false);
+				int body = pos + 8;
+				if (id == "fmt " && size >= 16) {
+					int format = (int)ReadUInt(data, body, 2, false);
+					channels = (int)ReadUInt(data, body + 2, 2, false);
+					sampleRate = ReadUInt(data, body + 4, 4, false);
+					bits = (int)ReadUInt(data, body + 14, 2, false);
+					//WAVE_FORMAT_EXTENSIBLE, the format is the start of the sub format GUID
+					if (format == 0xFFFE && size >= 26) {
+						format = (int)ReadUInt(data, body + 24, 2, false);
+					}
+					if (format != 1 && format != 3) {
+						return false;
+					}
+					isFloat = format == 3;
+				} else if (id == "data") {
+					dataOffset = body;
+					dataSize = Math.Min(size, data.Length - body);
+				}
+				pos = body + size + (size & 1);
+			}
+		} else if (riff == "FORM" && (form == "AIFF" || form == "AIFC")) {
+			bigEndian = true;
+			for (int pos = 12; pos + 8 <= data.Length;) {
+				string id = Encoding.ASCII.GetString(data, pos, 4);
+				int size = (int)ReadUInt(data, pos + 4, 4, true);
+				int body = pos + 8;
+				if (id == "COMM" && size >= 18) {
+					channels = (int)ReadUInt(data, body, 2, true);
+					bits = (int)ReadUInt(data, body + 6, 2, true);
+					sampleRate = ReadExtended(data, body + 8);
+					if (form == "AIFC" && size >= 22) {
+						string compression = Encoding.ASCII.GetString(data, body + 18, 4);
+						if (compression == "sowt") {
+							bigEndian = false;
+						} else if (compression == "fl32" || compression == "FL32" || compression == "fl64" || compression == "FL64") {
+							isFloat = true;
+						} else if (compression != "NONE") {
+							return false;
+						}
+					}
+				} else if (id == "SSND" && size >= 8) {
+					int offset = (int)ReadUInt(data, body, 4, true);
+					dataOffset = body + 8 + offset;
+					dataSize = Math.Min(size - 8 - offset, data.Length - dataOffset);
+				}
+				pos = body + size + (size & 1);
+			}
+		} else {
+			return false;
+		}
+
+		int bytes = bits / 8;
+		bool supported = isFloat ? (bits == 32 || bits == 64) : (bits == 8 || bits == 16 || bits == 24 || bits == 32);
+		if (!supported || channels <= 0 || sampleRate <= 0.0 || dataOffset < 0) {
+			return false;
+		}
+
+		int count = dataSize / bytes;
+		count -= count % channels;
+		samples = new float[count];
+		for (int i = 0; i < count; i++) {
+			int p = dataOffset + i * bytes;
+			if (isFloat) {
+				byte[] b = new byte[bytes];
+				Array.Copy(data, p, b, 0, bytes);
+				if (bigEndian == BitConverter.IsLittleEndian) {
+					Array.Reverse(b);
+				}
+				samples[i] = bits == 32 ? BitConverter.ToSingle(b, 0) : (float)BitConverter.ToDouble(b, 0);
+			} else if (bits == 8) {
+				//8 bit WAV is unsigned, 8 bit AIFF is signed
+				samples[i] = bigEndian ? (sbyte)data[p] / 128.0f : (data[p] - 128) / 128.0f;
+			} else {
+				//shift up to 32 bits to sign extend
+				int v = (int)(ReadUInt(data, p, bytes, bigEndian) << (32 - bits));
+				samples[i] = (float)(v / 2147483648.0);
+			}
+		}
+		return true;
+	}
+
+	static uint ReadUInt(byte[] data, int pos, int count, bool bigEndian) {
+		uint v = 0;
+		for (int i = 0; i < count; i++) {
+			int b = bigEndian ? data[pos + i] : data[pos + count - 1 - i];
+			v = (v << 8) | (uint)b;
+		}
+		return v;
+	}
+
+	//80 bit IEEE 754 extended, used for the AIFF sample rate
+	static double ReadExtended(byte[] data, int pos) {
+		int exponent = ((data[pos] & 0x7F) << 8) | data[pos + 1];
+		ulong mantissa = ((ulong)ReadUInt(data, pos + 2, 4, true) << 32) | ReadUInt(data, pos + 6, 4, true);
+		if (exponent == 0 && mantissa == 0) {
+			return 0.0;
+		}
+		double v = mantissa * Math.Pow(2.0, exponent - 16383 - 63);
+		return (data[pos] & 0x80) != 0 ? -v : v;
 	}
 }